@@ -18,6 +18,7 @@
 #include "filters.h"
 #include "settings.h"
 #include "main.h"
+#include "snapshot.h"
 #include <rtcom-eventlogger/eventlogger.h>
 #include <libebook/e-book.h>
 #include <libosso-abook/osso-abook.h>
@@ -27,25 +28,27 @@
 #include "rtcom-eventlogger-ui/rtcom-log-search-bar.h"
 
 
-void query_prepare(RTComElQuery* query, gpointer data)
+QueryFilter *query_filter_new(AppData *appdata)
 {
-	gchar * eventtype = NULL;
-	gint outgoing = -1;
-	AppData *appdata = data;
+	QueryFilter *filter = g_new0(QueryFilter, 1);
 
+	filter->current_type = appdata->current_type;
+	filter->current_direction = appdata->current_direction;
+	filter->filter_by_date = appdata->filter_by_date;
+	filter->start_date = appdata->start_date;
+	filter->end_date = appdata->end_date;
+	filter->db = appdata->db;
 
-	if(appdata->filter_by_date)
-	{
-		/*disable the limit filter because we want to get all calls between certain dates*/
-		g_debug("no limit because of date");
-		rtcom_log_model_set_limit(appdata->log_model, -1);
-	}
-	else
-	{
-		/*re-enable the limit filter*/
-		g_debug("using the limit");
-		rtcom_log_model_set_limit(appdata->log_model, get_limit());
-	}
+	return filter;
+}
+
+/* Called by the model for every page it loads, possibly from its caching
+ * thread, so it only looks at its own copy of the filter settings. */
+gboolean query_prepare(RTComElQuery* query, gint before_id, gpointer data)
+{
+	gchar * eventtype = NULL;
+	gint outgoing = -1;
+	QueryFilter *appdata = data;
 
 	switch(appdata->current_direction){
 		case INBOUND:
@@ -81,8 +84,9 @@ void query_prepare(RTComElQuery* query, gpointer data)
 		{
 			if(appdata->filter_by_date)
 			{
-				rtcom_el_query_prepare(query,
+				return rtcom_el_query_prepare(query,
 				   	"service", "RTCOM_EL_SERVICE_CALL", RTCOM_EL_OP_EQUAL,
+				   	"id", before_id, RTCOM_EL_OP_LESS,
 				   	"local-uid", "ring/tel/ring", RTCOM_EL_OP_EQUAL,
 				   	"start-time", appdata->start_date, RTCOM_EL_OP_GREATER,
 				   	"start-time", appdata->end_date, RTCOM_EL_OP_LESS,
@@ -90,8 +94,9 @@ void query_prepare(RTComElQuery* query, gpointer data)
 			}
 			else
 			{
-				rtcom_el_query_prepare(query,
+				return rtcom_el_query_prepare(query,
 				 	"service", "RTCOM_EL_SERVICE_CALL", RTCOM_EL_OP_EQUAL,
+				 	"id", before_id, RTCOM_EL_OP_LESS,
 				  	"local-uid", "ring/tel/ring", RTCOM_EL_OP_EQUAL,
 				  	NULL);
 			}
@@ -101,8 +106,9 @@ void query_prepare(RTComElQuery* query, gpointer data)
 		{
 			if(appdata->filter_by_date)
 			{
-				rtcom_el_query_prepare(query,
+				return rtcom_el_query_prepare(query,
 					"service", "RTCOM_EL_SERVICE_CALL", RTCOM_EL_OP_EQUAL,
+					"id", before_id, RTCOM_EL_OP_LESS,
 					"local-uid", "ring/tel/ring", RTCOM_EL_OP_NOT_EQUAL,
 					"start-time", appdata->start_date, RTCOM_EL_OP_GREATER,
 					"start-time", appdata->end_date, RTCOM_EL_OP_LESS,
@@ -110,8 +116,9 @@ void query_prepare(RTComElQuery* query, gpointer data)
 			}
 			else
 			{
-				rtcom_el_query_prepare(query,
+				return rtcom_el_query_prepare(query,
 					"service", "RTCOM_EL_SERVICE_CALL", RTCOM_EL_OP_EQUAL,
+					"id", before_id, RTCOM_EL_OP_LESS,
 					"local-uid", "ring/tel/ring", RTCOM_EL_OP_NOT_EQUAL,
 					NULL);
 			}
@@ -120,16 +127,18 @@ void query_prepare(RTComElQuery* query, gpointer data)
 		{
 			if(appdata->filter_by_date)
 			{
-				rtcom_el_query_prepare(query,
+				return rtcom_el_query_prepare(query,
 					"service", "RTCOM_EL_SERVICE_CALL", RTCOM_EL_OP_EQUAL,
+					"id", before_id, RTCOM_EL_OP_LESS,
 					"start-time", appdata->start_date, RTCOM_EL_OP_GREATER,
 				   	"start-time", appdata->end_date, RTCOM_EL_OP_LESS,
 					NULL);
 			}
 			else
 			{
-				rtcom_el_query_prepare(query,
+				return rtcom_el_query_prepare(query,
 					"service", "RTCOM_EL_SERVICE_CALL", RTCOM_EL_OP_EQUAL,
+					"id", before_id, RTCOM_EL_OP_LESS,
 					NULL);
 			}
 		}
@@ -143,8 +152,9 @@ void query_prepare(RTComElQuery* query, gpointer data)
 		{
 			if(appdata->filter_by_date)
 			{
-				rtcom_el_query_prepare(query,
+				return rtcom_el_query_prepare(query,
 					"service", "RTCOM_EL_SERVICE_CALL", RTCOM_EL_OP_EQUAL,
+					"id", before_id, RTCOM_EL_OP_LESS,
 					"event-type", eventtype, RTCOM_EL_OP_EQUAL,
 					"outgoing", outgoing, RTCOM_EL_OP_EQUAL,
 					"local-uid", "ring/tel/ring", RTCOM_EL_OP_EQUAL,
@@ -154,8 +164,9 @@ void query_prepare(RTComElQuery* query, gpointer data)
 			}
 			else
 			{
-				rtcom_el_query_prepare(query,
+				return rtcom_el_query_prepare(query,
 					"service", "RTCOM_EL_SERVICE_CALL", RTCOM_EL_OP_EQUAL,
+					"id", before_id, RTCOM_EL_OP_LESS,
 					"outgoing", outgoing, RTCOM_EL_OP_EQUAL,
 					"event-type", eventtype, RTCOM_EL_OP_EQUAL,
 					"local-uid", "ring/tel/ring", RTCOM_EL_OP_EQUAL,
@@ -166,8 +177,9 @@ void query_prepare(RTComElQuery* query, gpointer data)
 		{
 			if(appdata->filter_by_date)
 			{
-				rtcom_el_query_prepare(query,
+				return rtcom_el_query_prepare(query,
 					"service", "RTCOM_EL_SERVICE_CALL", RTCOM_EL_OP_EQUAL,
+					"id", before_id, RTCOM_EL_OP_LESS,
 					"event-type", eventtype, RTCOM_EL_OP_EQUAL,
 					"outgoing", outgoing, RTCOM_EL_OP_EQUAL,
 					"local-uid", "ring/tel/ring", RTCOM_EL_OP_NOT_EQUAL,
@@ -177,8 +189,9 @@ void query_prepare(RTComElQuery* query, gpointer data)
 			}
 			else
 			{
-				rtcom_el_query_prepare(query,
+				return rtcom_el_query_prepare(query,
 					"service", "RTCOM_EL_SERVICE_CALL", RTCOM_EL_OP_EQUAL,
+					"id", before_id, RTCOM_EL_OP_LESS,
 					"event-type", eventtype, RTCOM_EL_OP_EQUAL,
 					"outgoing", outgoing, RTCOM_EL_OP_EQUAL,
 					"local-uid", "ring/tel/ring", RTCOM_EL_OP_NOT_EQUAL,
@@ -190,8 +203,9 @@ void query_prepare(RTComElQuery* query, gpointer data)
 			if(appdata->filter_by_date)
 			{
 				g_debug("creating date filter where event type set and call type all");
-				rtcom_el_query_prepare(query,
+				return rtcom_el_query_prepare(query,
 					"service", "RTCOM_EL_SERVICE_CALL", RTCOM_EL_OP_EQUAL,
+					"id", before_id, RTCOM_EL_OP_LESS,
 					"outgoing", outgoing, RTCOM_EL_OP_EQUAL,
 					"event-type", eventtype, RTCOM_EL_OP_EQUAL,
 					"start-time", appdata->start_date, RTCOM_EL_OP_GREATER,
@@ -202,8 +216,9 @@ void query_prepare(RTComElQuery* query, gpointer data)
 			else
 			{
 				g_debug("creating filter where event type set and call type all");
-				rtcom_el_query_prepare(query,
+				return rtcom_el_query_prepare(query,
 					"service", "RTCOM_EL_SERVICE_CALL", RTCOM_EL_OP_EQUAL,
+					"id", before_id, RTCOM_EL_OP_LESS,
 					"outgoing", outgoing, RTCOM_EL_OP_EQUAL,
 					"event-type", eventtype, RTCOM_EL_OP_EQUAL,
 					NULL);
@@ -212,6 +227,84 @@ void query_prepare(RTComElQuery* query, gpointer data)
 	}
 }
 
+/* The same selection as query_prepare, read straight from the database. */
+gboolean query_read(RTComLogEventBatch *batch, gint before_id, gint limit, gpointer data)
+{
+	QueryFilter *appdata = data;
+	RTComLogDbFilter filter;
+
+	if(appdata->db == NULL)
+		return FALSE;
+
+	memset(&filter, 0, sizeof(RTComLogDbFilter));
+	filter.outgoing = -1;
+
+	switch(appdata->current_direction){
+		case INBOUND:
+			filter.event_type = "RTCOM_EL_EVENTTYPE_CALL";
+			filter.outgoing = 0;
+			break;
+		case OUTBOUND:
+			filter.event_type = "RTCOM_EL_EVENTTYPE_CALL";
+			filter.outgoing = 1;
+			break;
+		case MISSED:
+			filter.event_type = "RTCOM_EL_EVENTTYPE_CALL_MISSED";
+			filter.outgoing = 0;
+			break;
+		default:
+			break;
+	}
+
+	if(appdata->current_type == GSM)
+	{
+		filter.local_uid = "ring/tel/ring";
+	}
+	else if(appdata->current_type == VOIP)
+	{
+		filter.local_uid = "ring/tel/ring";
+		filter.not_local_uid = TRUE;
+	}
+
+	filter.by_date = appdata->filter_by_date;
+	filter.start_time = appdata->start_date;
+	filter.end_time = appdata->end_date;
+
+	return rtcom_log_db_read_calls(appdata->db, &filter, before_id, limit, batch);
+}
+
+void populate_filtered(AppData *appdata)
+{
+	gboolean direct_db = get_direct_db();
+
+	if(appdata->filter_by_date)
+	{
+		/*disable the limit filter because we want to get all calls between certain dates*/
+		g_debug("no limit because of date");
+		rtcom_log_model_set_limit(appdata->log_model, -1);
+	}
+	else
+	{
+		/*re-enable the limit filter*/
+		g_debug("using the limit");
+		rtcom_log_model_set_limit(appdata->log_model, get_limit());
+	}
+
+	if(direct_db && appdata->db == NULL)
+	{
+		gchar *path = rtcom_log_db_default_path();
+
+		g_debug("opening %s for direct reads", path);
+		appdata->db = rtcom_log_db_open(path);
+		g_free(path);
+	}
+
+	rtcom_log_model_set_read_func(appdata->log_model,
+			(direct_db && appdata->db != NULL) ? query_read : NULL);
+	rtcom_log_model_populate_query_func(appdata->log_model, query_prepare,
+			query_filter_new(appdata), g_free);
+}
+
 void missed_calls (GtkButton* button, gpointer data)
 {
 	if(!gtk_toggle_button_get_active(button))
@@ -224,18 +317,7 @@ void missed_calls (GtkButton* button, gpointer data)
 
     g_debug("missed calls...");
 
-    RTComElQuery *query = NULL;
-    RTComEl * eventlogger = NULL;
-    eventlogger = rtcom_log_model_get_eventlogger(appdata->log_model);
-    query = rtcom_el_query_new(eventlogger);
-    /*rtcom_el_query_prepare(query,
-    		"service", "RTCOM_EL_SERVICE_CALL", RTCOM_EL_OP_EQUAL,
-    		"event-type", "RTCOM_EL_EVENTTYPE_CALL_MISSED", RTCOM_EL_OP_EQUAL,
-    		NULL);*/
-    query_prepare(query, appdata);
-
-    rtcom_log_model_populate_query(appdata->log_model, query);
-    g_object_unref(query);
+    populate_filtered(appdata);
 }
 
 void recieved_calls (GtkButton* button, gpointer data)
@@ -248,19 +330,7 @@ void recieved_calls (GtkButton* button, gpointer data)
 	AppData *appdata = data;
 	appdata->current_direction = INBOUND;
     g_debug("recieved calls...");
-    RTComElQuery *query = NULL;
-    RTComEl * eventlogger = NULL;
-    eventlogger = rtcom_log_model_get_eventlogger(appdata->log_model);
-    query = rtcom_el_query_new(eventlogger);
-    /*rtcom_el_query_prepare(query,
-    		"service", "RTCOM_EL_SERVICE_CALL", RTCOM_EL_OP_EQUAL,
-    		"event-type", "RTCOM_EL_EVENTTYPE_CALL_INBOUND", RTCOM_EL_OP_EQUAL,
-    		NULL);
-    		*/
-    query_prepare(query, appdata);
-
-    rtcom_log_model_populate_query(appdata->log_model, query);
-    g_object_unref(query);
+    populate_filtered(appdata);
 }
 
 void dialed_calls (GtkButton* button, gpointer data)
@@ -273,18 +343,7 @@ void dialed_calls (GtkButton* button, gpointer data)
 	AppData *appdata = data;
 	appdata->current_direction = OUTBOUND;
     g_debug("dialed calls...");
-    RTComElQuery *query = NULL;
-    RTComEl * eventlogger = NULL;
-    eventlogger = rtcom_log_model_get_eventlogger(appdata->log_model);
-    query = rtcom_el_query_new(eventlogger);
-    /*rtcom_el_query_prepare(query,
-    		"service", "RTCOM_EL_SERVICE_CALL", RTCOM_EL_OP_EQUAL,
-    		"event-type", "RTCOM_EL_EVENTTYPE_CALL_OUTBOUND", RTCOM_EL_OP_EQUAL,
-    		NULL);*/
-    query_prepare(query, appdata);
-
-    rtcom_log_model_populate_query(appdata->log_model, query);
-    g_object_unref(query);
+    populate_filtered(appdata);
 }
 
 void voip_calls (GtkButton* button, gpointer data)
@@ -298,18 +357,7 @@ void voip_calls (GtkButton* button, gpointer data)
 	appdata->current_type = VOIP;
 
     g_debug("voip calls...");
-    RTComElQuery *query = NULL;
-    RTComEl * eventlogger = NULL;
-    eventlogger = rtcom_log_model_get_eventlogger(appdata->log_model);
-    query = rtcom_el_query_new(eventlogger);
-    /*rtcom_el_query_prepare(query,
-    		"service", "RTCOM_EL_SERVICE_CALL", RTCOM_EL_OP_EQUAL,
-    		"local-uid", "ring/tel/ring", RTCOM_EL_OP_NOT_EQUAL,
-    		NULL);*/
-    query_prepare(query, appdata);
-
-    rtcom_log_model_populate_query(appdata->log_model, query);
-    g_object_unref(query);
+    populate_filtered(appdata);
 }
 
 void gsm_calls (GtkButton* button, gpointer data)
@@ -323,19 +371,7 @@ void gsm_calls (GtkButton* button, gpointer data)
 	appdata->current_type = GSM;
 
     g_debug("gsm calls...");
-    RTComElQuery *query = NULL;
-    RTComEl * eventlogger = NULL;
-    eventlogger = rtcom_log_model_get_eventlogger(appdata->log_model);
-    query = rtcom_el_query_new(eventlogger);
-    /*rtcom_el_query_prepare(query,
-    		"service", "RTCOM_EL_SERVICE_CALL", RTCOM_EL_OP_EQUAL,
-    		"local-uid", "ring/tel/ring", RTCOM_EL_OP_EQUAL,
-    		NULL);
-    		*/
-    query_prepare(query, appdata);
-
-    rtcom_log_model_populate_query(appdata->log_model, query);
-    g_object_unref(query);
+    populate_filtered(appdata);
 }
 
 void all_call_types (GtkButton* button, gpointer data)
@@ -349,19 +385,7 @@ void all_call_types (GtkButton* button, gpointer data)
 	appdata->current_type = ALL;
 
     g_debug("gsm calls...");
-    RTComElQuery *query = NULL;
-    RTComEl * eventlogger = NULL;
-    eventlogger = rtcom_log_model_get_eventlogger(appdata->log_model);
-    query = rtcom_el_query_new(eventlogger);
-    /*rtcom_el_query_prepare(query,
-    		"service", "RTCOM_EL_SERVICE_CALL", RTCOM_EL_OP_EQUAL,
-    		"local-uid", "ring/tel/ring", RTCOM_EL_OP_EQUAL,
-    		NULL);
-    		*/
-    query_prepare(query, appdata);
-
-    rtcom_log_model_populate_query(appdata->log_model, query);
-    g_object_unref(query);
+    populate_filtered(appdata);
 }
 
 void all_call_directions (GtkButton* button, gpointer data)
@@ -375,15 +399,7 @@ void all_call_directions (GtkButton* button, gpointer data)
 	appdata->current_direction = ALL_DIRECTIONS;
 
     g_debug("all directions...");
-    RTComElQuery *query = NULL;
-    RTComEl * eventlogger = NULL;
-    eventlogger = rtcom_log_model_get_eventlogger(appdata->log_model);
-    query = rtcom_el_query_new(eventlogger);
-
-    query_prepare(query, appdata);
-
-    rtcom_log_model_populate_query(appdata->log_model, query);
-    g_object_unref(query);
+    populate_filtered(appdata);
 }
 
 void populate_calls(GtkWidget * widget, gpointer data)
@@ -402,15 +418,7 @@ void populate_calls_default(AppData* data)
 
 	g_debug("populationg calls for first time");
 	appdata->current_direction = ALL_DIRECTIONS;
-	RTComElQuery *query = NULL;
-	RTComEl * eventlogger = NULL;
-	eventlogger = rtcom_log_model_get_eventlogger(appdata->log_model);
-	query = rtcom_el_query_new(eventlogger);
-
-	query_prepare(query, appdata);
-
-	rtcom_log_model_populate_query(appdata->log_model, query);
-	g_object_unref(query);
+	populate_filtered(appdata);
 }
 
 void filter_by_date (gpointer data)
@@ -418,15 +426,70 @@ void filter_by_date (gpointer data)
 	AppData *appdata = data;
 
     g_debug("filtering by date");
-    RTComElQuery *query = NULL;
-    RTComEl * eventlogger = NULL;
-    eventlogger = rtcom_log_model_get_eventlogger(appdata->log_model);
-    query = rtcom_el_query_new(eventlogger);
+    populate_filtered(appdata);
+}
 
-    query_prepare(query, appdata);
+static void delete_filtered_progress(RTComLogModel *model, guint deleted,
+		guint total, gboolean done, const GError *error, gpointer data)
+{
+	AppData *appdata = data;
+
+	if(!done)
+	{
+		if(total > 0)
+			gtk_progress_bar_set_fraction(
+					GTK_PROGRESS_BAR(appdata->delete_progress),
+					(gdouble) deleted / total);
+		return;
+	}
+
+	gtk_widget_destroy(appdata->delete_banner);
+	appdata->delete_banner = NULL;
+	appdata->delete_progress = NULL;
+
+	gchar *msg;
+	if(error)
+		msg = g_strdup_printf("%u Calls Deleted from Call Log. %s",
+				deleted, error->message);
+	else
+		msg = g_strdup_printf("%u Calls Deleted from Call Log", deleted);
+	hildon_banner_show_information(GTK_WIDGET(appdata->mainWindow), NULL, msg);
+	g_free(msg);
+
+	/* The rows are gone from the model already, no need to reload */
+	snapshot_save(appdata);
+}
 
-    rtcom_log_model_populate_query(appdata->log_model, query);
-    g_object_unref(query);
+/* Deletes every call the menu filters select, not only the loaded ones. */
+void delete_filtered(GtkButton* button, gpointer data)
+{
+	AppData *appdata = data;
+	GtkWidget *note;
+	gint response;
+
+	if(appdata->delete_banner != NULL)
+		return;
+
+	note = hildon_note_new_confirmation(GTK_WINDOW(appdata->mainWindow),
+			"Delete all calls matching the current filter?");
+	response = gtk_dialog_run(GTK_DIALOG(note));
+	gtk_widget_destroy(note);
+
+	if(response != GTK_RESPONSE_OK)
+		return;
+
+	appdata->delete_progress = gtk_progress_bar_new();
+	appdata->delete_banner = hildon_banner_show_progress(
+			GTK_WIDGET(appdata->mainWindow),
+			GTK_PROGRESS_BAR(appdata->delete_progress), "Deleting calls");
+
+	if(!rtcom_log_model_delete_matching(appdata->log_model,
+				delete_filtered_progress, appdata))
+	{
+		gtk_widget_destroy(appdata->delete_banner);
+		appdata->delete_banner = NULL;
+		appdata->delete_progress = NULL;
+	}
 }
 
 void refresh(GtkWidget * widget, gpointer data)
@@ -436,5 +499,6 @@ void refresh(GtkWidget * widget, gpointer data)
     g_debug("Refreshing...");
 
     rtcom_log_model_refresh(appdata->log_model);
+    snapshot_save(appdata);
 }
 
@@ -26,6 +26,7 @@
 #include "rtcom-eventlogger-ui/rtcom-log-model.h"
 #include "rtcom-eventlogger-ui/rtcom-log-columns.h"
 #include "rtcom-eventlogger-ui/rtcom-log-search-bar.h"
+#include "rtcom-eventlogger-ui/rtcom-log-db.h"
 #include "settings.h"
 #include "main.h"
 
@@ -38,7 +39,21 @@ typedef enum {
   MISSED
 } call_direction;
 
-void query_prepare(RTComElQuery* query, gpointer data);
+/* Copy of the filter settings a query is built from, so the model can
+ * rebuild its query for every page without looking at AppData. */
+typedef struct {
+	gint current_type;
+	gint current_direction;
+	gboolean filter_by_date;
+	gint start_date;
+	gint end_date;
+	RTComLogDb *db;
+} QueryFilter;
+
+QueryFilter *query_filter_new(AppData *appdata);
+gboolean query_prepare(RTComElQuery* query, gint before_id, gpointer data);
+gboolean query_read(RTComLogEventBatch *batch, gint before_id, gint limit, gpointer data);
+void populate_filtered(AppData *appdata);
 void missed_calls (GtkButton* button, gpointer data);
 void recieved_calls (GtkButton* button, gpointer data);
 void dialed_calls (GtkButton* button, gpointer data);
@@ -49,6 +64,7 @@ void all_call_directions (GtkButton* button, gpointer data);
 void populate_calls(GtkWidget * widget, gpointer data);
 void populate_calls_default(AppData* data);
 void filter_by_date (gpointer data);
+void delete_filtered(GtkButton* button, gpointer data);
 void refresh(GtkWidget * widget, gpointer data);
 
 G_END_DECLS
@@ -48,6 +48,7 @@
 #include "localisation.h"
 #include "settings.h"
 #include "filters.h"
+#include "snapshot.h"
 #include "he-about-dialog.h"
 
 #define CSD_CALL_BUS_NAME	"com.nokia.csd.Call"
@@ -220,21 +221,90 @@ static void make_call(GtkButton* button, gpointer data)
 static void delete_record(GtkButton* button, gpointer data)
 {
 	g_debug("delete record...");
-	gint id = (int) data;
+	AppData * appdata = data;
+	gint id = GPOINTER_TO_INT(g_object_get_data(G_OBJECT(button), "event-id"));
 	g_debug("id is %d", id);
-	RTComEl *el = rtcom_el_new ();
-	if(!RTCOM_IS_EL(el))
+
+	/* Goes through the model's own RTComEl, so the row goes at once */
+	if(rtcom_log_model_delete_events(appdata->log_model, &id, 1, NULL) == 0)
 	{
-		g_debug("couldn't setup RTComEl\n");
+		g_debug("couldn't delete event %d\n", id);
 		return;
 	}
 
-	rtcom_el_delete_event(el, id, NULL);
 	GtkWidget *banner = hildon_banner_show_information(NULL, NULL,
 							"Call Deleted from Call Log");
 
 }
 
+static void leave_delete_mode(AppData *appdata)
+{
+	rtcom_log_view_set_multi_select(RTCOM_LOG_VIEW(appdata->log_view), FALSE);
+	gtk_widget_destroy(appdata->edit_toolbar);
+	appdata->edit_toolbar = NULL;
+	gtk_window_unfullscreen(GTK_WINDOW(appdata->mainWindow));
+}
+
+static void delete_selected(HildonEditToolbar *toolbar, gpointer data)
+{
+	AppData *appdata = data;
+	GArray *ids, *failed;
+	guint deleted;
+	gchar *msg;
+
+	ids = rtcom_log_view_get_selected_event_ids(
+			RTCOM_LOG_VIEW(appdata->log_view));
+	if(ids->len == 0)
+	{
+		hildon_banner_show_information(GTK_WIDGET(appdata->mainWindow),
+				NULL, "No calls selected");
+		g_array_free(ids, TRUE);
+		return;
+	}
+
+	failed = g_array_new(FALSE, FALSE, sizeof(gint));
+	deleted = rtcom_log_model_delete_events(appdata->log_model,
+			(const gint *) ids->data, ids->len, failed);
+	g_array_free(ids, TRUE);
+
+	if(failed->len > 0)
+		msg = g_strdup_printf("%u Calls Deleted from Call Log, "
+				"%u could not be deleted", deleted, failed->len);
+	else
+		msg = g_strdup_printf("%u Calls Deleted from Call Log", deleted);
+	hildon_banner_show_information(GTK_WIDGET(appdata->mainWindow), NULL, msg);
+	g_free(msg);
+	g_array_free(failed, TRUE);
+
+	leave_delete_mode(appdata);
+}
+
+static void cancel_delete(HildonEditToolbar *toolbar, gpointer data)
+{
+	leave_delete_mode(data);
+}
+
+static void delete_calls_clicked(GtkButton* button, gpointer data)
+{
+	AppData *appdata = data;
+
+	if(appdata->edit_toolbar != NULL)
+		return;
+
+	appdata->edit_toolbar = hildon_edit_toolbar_new_with_text(
+			"Select calls to delete", "Delete");
+	g_signal_connect(G_OBJECT(appdata->edit_toolbar), "button-clicked",
+			G_CALLBACK(delete_selected), appdata);
+	g_signal_connect(G_OBJECT(appdata->edit_toolbar), "arrow-clicked",
+			G_CALLBACK(cancel_delete), appdata);
+	hildon_window_set_edit_toolbar(HILDON_WINDOW(appdata->mainWindow),
+			HILDON_EDIT_TOOLBAR(appdata->edit_toolbar));
+	gtk_widget_show(appdata->edit_toolbar);
+
+	rtcom_log_view_set_multi_select(RTCOM_LOG_VIEW(appdata->log_view), TRUE);
+	gtk_window_fullscreen(GTK_WINDOW(appdata->mainWindow));
+}
+
 static void show_contact(GtkButton* button, gpointer data)
 {
 	/*
@@ -290,7 +360,7 @@ void row_activated(GtkTreeView *tree_view, GtkTreePath *path,
 	 *
 	 */
     OssoABookContact *contact;
-    guint event_id;
+    gint event_id;
     gchar *remote_name;
     gchar *remote_uid;
     gchar *local_account;
@@ -426,11 +496,13 @@ void row_activated(GtkTreeView *tree_view, GtkTreePath *path,
 	gtk_box_set_spacing(GTK_BOX(button_box), 10);
 	delete_button = gtk_button_new_with_label("Delete");
 	hildon_gtk_widget_set_theme_size(delete_button, HILDON_SIZE_FINGER_HEIGHT);
+	g_object_set_data(G_OBJECT(delete_button), "event-id",
+	          GINT_TO_POINTER(event_id));
 	g_signal_connect(
 	          G_OBJECT(delete_button),
 	          "clicked",
 	          G_CALLBACK(delete_record),
-	          event_id);
+	          data);
 	g_signal_connect(
 		          G_OBJECT(delete_button),
 		          "clicked",
@@ -878,6 +950,11 @@ some_page_func (GtkNotebook *nb,
 	return TRUE;
 }
 
+static void toggle_direct_db (GtkButton* button, gpointer data)
+{
+	set_direct_db(hildon_check_button_get_active(HILDON_CHECK_BUTTON(button)));
+}
+
 void all_default (GtkButton* button, gpointer data)
 {
 	if(!gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(button)))
@@ -918,6 +995,7 @@ create_settings_wizard(AppData *appdata)
 	GtkWidget *limit_label;
 	GtkWidget *desc_label;
 	GtkWidget *limit_entry;
+	GtkWidget *direct_db_button;
 	GtkWidget *all_button, *voip_button, *gsm_button;
 	GtkWidget *main_vbox;
 	GtkWidget *type_vbox;
@@ -955,6 +1033,20 @@ create_settings_wizard(AppData *appdata)
 	gtk_box_pack_start (GTK_BOX (main_vbox), limit_entry, FALSE, FALSE, 0);
 	gtk_box_pack_start (GTK_BOX (main_vbox), desc_label, FALSE, FALSE, 0);
 
+	/* Packed after the entry, some_page_func finds that by position */
+	direct_db_button = hildon_check_button_new(HILDON_SIZE_AUTO);
+	gtk_button_set_label(GTK_BUTTON(direct_db_button), "Read Calls From Database");
+	hildon_check_button_set_active(HILDON_CHECK_BUTTON(direct_db_button), get_direct_db());
+	hildon_gtk_widget_set_theme_size(direct_db_button, HILDON_SIZE_FINGER_HEIGHT);
+
+	g_signal_connect(
+			G_OBJECT(direct_db_button),
+	        "toggled",
+	        G_CALLBACK(toggle_direct_db),
+	        NULL);
+
+	gtk_box_pack_start (GTK_BOX (main_vbox), direct_db_button, FALSE, FALSE, 0);
+
 	/*
 	 * default type page
 	 */
@@ -1060,8 +1152,63 @@ settings_clicked(
     g_debug("Create Settings...");
     create_settings_wizard(appdata);
     g_debug("Refreshing...");
-    rtcom_log_model_set_limit(appdata->log_model, get_limit());
-    rtcom_log_model_refresh(appdata->log_model);
+    /* Repopulate rather than refresh, the reader may have been switched */
+    populate_filtered(appdata);
+    snapshot_save(appdata);
+}
+
+/* How long to wait for the snapshot to be drawn before populating anyway,
+ * for a window that is covered or on a blanked screen at startup */
+#define SNAPSHOT_POPULATE_TIMEOUT_MS 1000
+
+/* The pending expose handler and populate source, whichever fires first
+ * removes the other */
+static gulong snapshot_drawn_id = 0;
+static guint snapshot_populate_id = 0;
+
+static gboolean
+populate_after_snapshot(
+        gpointer user_data)
+{
+    AppData * appdata = user_data;
+
+    snapshot_populate_id = 0;
+    if (snapshot_drawn_id)
+    {
+        g_signal_handler_disconnect(appdata->log_view, snapshot_drawn_id);
+        snapshot_drawn_id = 0;
+    }
+
+    g_debug("replacing the snapshot with the real calls");
+    populate_calls_default(user_data);
+    return FALSE;
+}
+
+/* Runs the first query once the snapshot rows made it to the screen */
+static gboolean
+snapshot_drawn(
+        GtkWidget * widget,
+        GdkEventExpose * event,
+        gpointer user_data)
+{
+    g_signal_handler_disconnect(widget, snapshot_drawn_id);
+    snapshot_drawn_id = 0;
+
+    if (snapshot_populate_id)
+        g_source_remove(snapshot_populate_id);
+    snapshot_populate_id = g_idle_add(populate_after_snapshot, user_data);
+    return FALSE;
+}
+
+static gboolean
+main_window_delete(
+        GtkWidget * widget,
+        GdkEvent * event,
+        gpointer user_data)
+{
+    snapshot_save(user_data);
+    gtk_main_quit();
+    return FALSE;
 }
 
 
@@ -1091,6 +1238,10 @@ int main( int argc, char* argv[] )
 	appdata.end_day = 0;
 	appdata.end_month = 0;
 	appdata.end_year = 0;
+	appdata.db = NULL;
+	appdata.edit_toolbar = NULL;
+	appdata.delete_banner = NULL;
+	appdata.delete_progress = NULL;
 
 
 
@@ -1108,6 +1259,8 @@ int main( int argc, char* argv[] )
     GtkWidget * call_type_button = NULL;
     GtkWidget * date_button = NULL;
     GtkWidget * settings_button = NULL;
+    GtkWidget * delete_calls_button = NULL;
+    GtkWidget * delete_filtered_button = NULL;
     GtkWidget * about_button = NULL;
     HildonAppMenu *menu;
 
@@ -1165,9 +1318,15 @@ int main( int argc, char* argv[] )
 
     rtcom_log_model_populate(appdata.log_model, services);
     */
-    GtkWidget *banner = hildon_banner_show_information(GTK_WIDGET(appdata.mainWindow), NULL,
+    /* Show what was on screen last time while the query runs, unless
+     * it's out of date */
+    gboolean from_snapshot = snapshot_show(&appdata);
+    if (!from_snapshot)
+    {
+        hildon_banner_show_information(GTK_WIDGET(appdata.mainWindow), NULL,
     					"Loading calls may take time. Please be patient");
-    populate_calls_default(&appdata);
+        populate_calls_default(&appdata);
+    }
 
     rtcom_log_search_bar_set_model(
             RTCOM_LOG_SEARCH_BAR(appdata.search_bar),
@@ -1211,6 +1370,24 @@ int main( int argc, char* argv[] )
     hildon_app_menu_append (menu, GTK_BUTTON (settings_button));
     gtk_widget_show(settings_button);
 
+    delete_calls_button = gtk_button_new_with_label("Delete Calls");
+    g_signal_connect(
+             G_OBJECT(delete_calls_button),
+              "clicked",
+              G_CALLBACK(delete_calls_clicked),
+              &appdata);
+    hildon_app_menu_append (menu, GTK_BUTTON (delete_calls_button));
+    gtk_widget_show(delete_calls_button);
+
+    delete_filtered_button = gtk_button_new_with_label("Delete All Matching");
+    g_signal_connect(
+             G_OBJECT(delete_filtered_button),
+              "clicked",
+              G_CALLBACK(delete_filtered),
+              &appdata);
+    hildon_app_menu_append (menu, GTK_BUTTON (delete_filtered_button));
+    gtk_widget_show(delete_filtered_button);
+
     /*setup the filters for the app menu*/
     all_button = hildon_gtk_radio_button_new (HILDON_SIZE_AUTO, NULL);
     gtk_button_set_label (GTK_BUTTON (all_button), "All");
@@ -1306,10 +1483,19 @@ int main( int argc, char* argv[] )
     g_signal_connect(G_OBJECT(appdata.log_view), "cursor-changed",
        		G_CALLBACK(cursor_changed), &appdata);
 
+    if (from_snapshot)
+    {
+        snapshot_drawn_id = g_signal_connect_after(
+                G_OBJECT(appdata.log_view), "expose-event",
+                G_CALLBACK(snapshot_drawn), &appdata);
+        snapshot_populate_id = g_timeout_add(SNAPSHOT_POPULATE_TIMEOUT_MS,
+                populate_after_snapshot, &appdata);
+    }
+
 
     /* Quit program when window is closed. */
     g_signal_connect (G_OBJECT (appdata.mainWindow), "delete_event",
-		      G_CALLBACK (gtk_main_quit), NULL);
+		      G_CALLBACK (main_window_delete), &appdata);
 
     /* Quit program when window is otherwise destroyed. */
     g_signal_connect (G_OBJECT (appdata.mainWindow), "destroy",
@@ -1330,6 +1516,10 @@ int main( int argc, char* argv[] )
     gtk_widget_show_all ( GTK_WIDGET ( appdata.mainWindow ) );
     gtk_main();
 
+    /* The model went with the window, and its loads with it, so
+     * nothing reads through the database any more. */
+    rtcom_log_db_close(appdata.db);
+
     /* Exit */
     return 0;
 }
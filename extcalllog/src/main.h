@@ -41,6 +41,7 @@
 #include "rtcom-eventlogger-ui/rtcom-log-model.h"
 #include "rtcom-eventlogger-ui/rtcom-log-columns.h"
 #include "rtcom-eventlogger-ui/rtcom-log-search-bar.h"
+#include "rtcom-eventlogger-ui/rtcom-log-db.h"
 #include "settings.h"
 
 G_BEGIN_DECLS
@@ -79,6 +80,12 @@ typedef struct
 	gint end_month;
 	gint end_year;
 	gint end_date;
+	RTComLogDb * db;
+	/* Shown while picking calls to delete */
+	GtkWidget * edit_toolbar;
+	/* Shown while deleting every call matching the filters */
+	GtkWidget * delete_banner;
+	GtkWidget * delete_progress;
 
 } AppData;
 
@@ -0,0 +1,328 @@
+/* This file is part of Extended Call Log
+ *
+ * Copyright (C) 2010 Thom Troy
+ *
+ * WebTexter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License (GPL) as published by
+ * the Free Software Foundation
+ *
+ * WebTexter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Extended Call Log. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "rtcom-log-db.h"
+
+#include <string.h>
+#include <sqlite3.h>
+
+#define CALL_SERVICE "RTCOM_EL_SERVICE_CALL"
+#define CALL_EVENT_TYPE "RTCOM_EL_EVENTTYPE_CALL"
+#define CALL_MISSED_EVENT_TYPE "RTCOM_EL_EVENTTYPE_CALL_MISSED"
+
+/* Parameters of CALLS_SQL */
+enum
+{
+    PARAM_SERVICE_ID = 1,
+    PARAM_BEFORE_ID,
+    PARAM_EVENT_TYPE,
+    PARAM_OUTGOING,
+    PARAM_LOCAL_UID,
+    PARAM_NOT_LOCAL_UID,
+    PARAM_BY_DATE,
+    PARAM_START_TIME,
+    PARAM_END_TIME,
+    PARAM_LIMIT
+};
+
+/* Columns of CALLS_SQL */
+enum
+{
+    COLUMN_ID,
+    COLUMN_EVENT_TYPE,
+    COLUMN_START_TIME,
+    COLUMN_END_TIME,
+    COLUMN_OUTGOING,
+    COLUMN_FLAGS,
+    COLUMN_LOCAL_UID,
+    COLUMN_REMOTE_UID,
+    COLUMN_FREE_TEXT,
+    COLUMN_GROUP_UID,
+    COLUMN_REMOTE_NAME,
+    COLUMN_ABOOK_UID,
+    COLUMN_EVENT_COUNT
+};
+
+/* Unused conditions are switched off through their parameters, so a
+ * single statement covers every filter of the call list. The event
+ * count comes from the group cache, as it does through the event
+ * logger: only the latest event of a group has one. */
+#define CALLS_SQL \
+    "SELECT Events.id, EventTypes.name, Events.start_time, " \
+    "Events.end_time, Events.outgoing, Events.flags, " \
+    "Events.local_uid, Events.remote_uid, " \
+    "Events.free_text, Events.group_uid, " \
+    "Remotes.remote_name, Remotes.abook_uid, " \
+    "GroupCache.total_events " \
+    "FROM Events " \
+    "JOIN EventTypes ON EventTypes.id = Events.event_type_id " \
+    "LEFT JOIN Remotes ON Remotes.local_uid = Events.local_uid " \
+    "AND Remotes.remote_uid = Events.remote_uid " \
+    "LEFT JOIN GroupCache ON GroupCache.event_id = Events.id " \
+    "WHERE Events.service_id = ?1 AND Events.id < ?2 " \
+    "AND (?3 IS NULL OR EventTypes.name = ?3) " \
+    "AND (?4 < 0 OR Events.outgoing = ?4) " \
+    "AND (?5 IS NULL OR (Events.local_uid = ?5) <> ?6) " \
+    "AND (?7 = 0 OR (Events.start_time > ?8 AND Events.start_time < ?9)) " \
+    "ORDER BY Events.id DESC LIMIT ?10"
+
+struct _RTComLogDb
+{
+    sqlite3 * db;
+    sqlite3_stmt * calls;
+    gint service_id;
+
+    /* The statement is shared by the caching thread and the main
+     * thread. */
+    GMutex * mutex;
+};
+
+gchar *
+rtcom_log_db_default_path(void)
+{
+    return g_build_filename(g_get_home_dir(),
+            ".rtcom-eventlogger", "el-v1.db", NULL);
+}
+
+static gboolean
+_lookup_service_id (sqlite3 * db, const gchar * name, gint * id)
+{
+    sqlite3_stmt * stmt = NULL;
+    gboolean found = FALSE;
+
+    if(sqlite3_prepare_v2(db, "SELECT id FROM Services WHERE name = ?1",
+                -1, &stmt, NULL) != SQLITE_OK)
+        return FALSE;
+
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+    if(sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        *id = sqlite3_column_int(stmt, 0);
+        found = TRUE;
+    }
+
+    sqlite3_finalize(stmt);
+
+    return found;
+}
+
+RTComLogDb *
+rtcom_log_db_open(
+        const gchar * path)
+{
+    RTComLogDb * db;
+
+    g_return_val_if_fail(path != NULL, NULL);
+
+    db = g_slice_new0(RTComLogDb);
+
+    if(sqlite3_open_v2(path, &db->db, SQLITE_OPEN_READONLY, NULL)
+            != SQLITE_OK)
+    {
+        g_warning("%s: couldn't open %s: %s", G_STRFUNC, path,
+                db->db ? sqlite3_errmsg(db->db) : "out of memory");
+        rtcom_log_db_close(db);
+        return NULL;
+    }
+
+    /* The event logger daemon keeps writing while we read. */
+    sqlite3_busy_timeout(db->db, 1000);
+
+    if(!_lookup_service_id(db->db, CALL_SERVICE, &db->service_id))
+    {
+        g_warning("%s: no " CALL_SERVICE " in %s", G_STRFUNC, path);
+        rtcom_log_db_close(db);
+        return NULL;
+    }
+
+    if(sqlite3_prepare_v2(db->db, CALLS_SQL, -1, &db->calls, NULL)
+            != SQLITE_OK)
+    {
+        g_warning("%s: couldn't prepare the call statement: %s",
+                G_STRFUNC, sqlite3_errmsg(db->db));
+        rtcom_log_db_close(db);
+        return NULL;
+    }
+
+    db->mutex = g_mutex_new();
+
+    return db;
+}
+
+void
+rtcom_log_db_close(
+        RTComLogDb * db)
+{
+    if(!db)
+        return;
+
+    if(db->calls)
+        sqlite3_finalize(db->calls);
+    if(db->db)
+        sqlite3_close(db->db);
+    if(db->mutex)
+        g_mutex_free(db->mutex);
+
+    g_slice_free(RTComLogDb, db);
+}
+
+/* The icons the call plugin gives to the same events. */
+static const gchar *
+_call_icon_name (const gchar * event_type, gboolean outgoing)
+{
+    if(event_type == NULL)
+        return NULL;
+
+    if(strcmp(event_type, CALL_MISSED_EVENT_TYPE) == 0)
+        return "general_missed";
+
+    if(strcmp(event_type, CALL_EVENT_TYPE) == 0)
+        return outgoing ? "general_sent" : "general_received";
+
+    return NULL;
+}
+
+#define _column_strdup(batch, stmt, column) \
+    rtcom_log_event_batch_strdup((batch), \
+            (const gchar *) sqlite3_column_text((stmt), (column)))
+#define _column_intern(stmt, column) \
+    g_intern_string((const gchar *) sqlite3_column_text((stmt), (column)))
+
+gboolean
+rtcom_log_db_read_calls(
+        RTComLogDb * db,
+        const RTComLogDbFilter * filter,
+        gint before_id,
+        gint limit,
+        RTComLogEventBatch * batch)
+{
+    sqlite3_stmt * stmt;
+    guint len;
+    gint rc;
+
+    g_return_val_if_fail(db != NULL, FALSE);
+    g_return_val_if_fail(filter != NULL, FALSE);
+    g_return_val_if_fail(batch != NULL, FALSE);
+
+    g_mutex_lock(db->mutex);
+
+    stmt = db->calls;
+    len = rtcom_log_event_batch_len(batch);
+
+    sqlite3_bind_int(stmt, PARAM_SERVICE_ID, db->service_id);
+    sqlite3_bind_int(stmt, PARAM_BEFORE_ID, before_id);
+    if(filter->event_type)
+        sqlite3_bind_text(stmt, PARAM_EVENT_TYPE, filter->event_type, -1,
+                SQLITE_STATIC);
+    else
+        sqlite3_bind_null(stmt, PARAM_EVENT_TYPE);
+    sqlite3_bind_int(stmt, PARAM_OUTGOING, filter->outgoing);
+    if(filter->local_uid)
+        sqlite3_bind_text(stmt, PARAM_LOCAL_UID, filter->local_uid, -1,
+                SQLITE_STATIC);
+    else
+        sqlite3_bind_null(stmt, PARAM_LOCAL_UID);
+    sqlite3_bind_int(stmt, PARAM_NOT_LOCAL_UID, filter->not_local_uid ? 1 : 0);
+    sqlite3_bind_int(stmt, PARAM_BY_DATE, filter->by_date ? 1 : 0);
+    sqlite3_bind_int(stmt, PARAM_START_TIME, filter->start_time);
+    sqlite3_bind_int(stmt, PARAM_END_TIME, filter->end_time);
+    sqlite3_bind_int(stmt, PARAM_LIMIT, limit);
+
+    while((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        RTComLogEvent event;
+
+        memset(&event, 0, sizeof(RTComLogEvent));
+
+        event.event_id = sqlite3_column_int(stmt, COLUMN_ID);
+        event.service = g_intern_static_string(CALL_SERVICE);
+        event.event_type = _column_intern(stmt, COLUMN_EVENT_TYPE);
+        event.timestamp = sqlite3_column_int(stmt, COLUMN_START_TIME);
+        event.end_timestamp = sqlite3_column_int(stmt, COLUMN_END_TIME);
+        event.outgoing = sqlite3_column_int(stmt, COLUMN_OUTGOING) != 0;
+        event.local_uid = _column_intern(stmt, COLUMN_LOCAL_UID);
+        event.remote_uid = _column_strdup(batch, stmt, COLUMN_REMOTE_UID);
+        event.remote_name = _column_strdup(batch, stmt, COLUMN_REMOTE_NAME);
+        event.remote_ebook_uid =
+            _column_strdup(batch, stmt, COLUMN_ABOOK_UID);
+        event.text = _column_strdup(batch, stmt, COLUMN_FREE_TEXT);
+        event.group_uid = _column_strdup(batch, stmt, COLUMN_GROUP_UID);
+        event.flags = sqlite3_column_int(stmt, COLUMN_FLAGS);
+        event.icon_name = _call_icon_name(event.event_type, event.outgoing);
+        /* NULL, for events without a group cache entry, reads as 0 */
+        event.count = sqlite3_column_int(stmt, COLUMN_EVENT_COUNT);
+
+        g_array_append_val(batch->events, event);
+    }
+
+    if(rc != SQLITE_DONE)
+    {
+        g_warning("%s: %s", G_STRFUNC, sqlite3_errmsg(db->db));
+        g_array_set_size(batch->events, len);
+    }
+
+    sqlite3_reset(stmt);
+
+    g_mutex_unlock(db->mutex);
+
+    return rc == SQLITE_DONE;
+}
+
+gboolean
+rtcom_log_db_get_call_stamp(
+        RTComLogDb * db,
+        gint * newest_id,
+        gint * n_calls)
+{
+    sqlite3_stmt * stmt = NULL;
+    gboolean ok = FALSE;
+
+    g_return_val_if_fail(db != NULL, FALSE);
+    g_return_val_if_fail(newest_id != NULL, FALSE);
+    g_return_val_if_fail(n_calls != NULL, FALSE);
+
+    g_mutex_lock(db->mutex);
+
+    if(sqlite3_prepare_v2(db->db,
+                "SELECT MAX(id), COUNT(*) FROM Events "
+                "WHERE service_id = ?1",
+                -1, &stmt, NULL) != SQLITE_OK)
+    {
+        g_warning("%s: %s", G_STRFUNC, sqlite3_errmsg(db->db));
+        g_mutex_unlock(db->mutex);
+        return FALSE;
+    }
+
+    sqlite3_bind_int(stmt, 1, db->service_id);
+    if(sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        /* MAX() of no rows is NULL, which reads as 0 */
+        *newest_id = sqlite3_column_int(stmt, 0);
+        *n_calls = sqlite3_column_int(stmt, 1);
+        ok = TRUE;
+    }
+    else
+        g_warning("%s: %s", G_STRFUNC, sqlite3_errmsg(db->db));
+
+    sqlite3_finalize(stmt);
+
+    g_mutex_unlock(db->mutex);
+
+    return ok;
+}
+
+/* vim: set ai et tw=75 ts=4 sw=4: */
@@ -0,0 +1,126 @@
+/* This file is part of Extended Call Log
+ *
+ * Copyright (C) 2010 Thom Troy
+ *
+ * WebTexter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License (GPL) as published by
+ * the Free Software Foundation
+ *
+ * WebTexter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Extended Call Log. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file rtcom-log-db.h
+ * @brief Direct, read-only access to the call events of the event logger
+ * database.
+ *
+ * Reading through rtcom_el_get_events() selects every column and runs the
+ * plugin machinery for every row. The call list only needs a handful of
+ * columns, so this reader goes to the SQLite database itself with a single
+ * prepared statement and fills an #RTComLogEventBatch.
+ *
+ * It relies on the Events, EventTypes, Services, Remotes and GroupCache
+ * tables of the event logger schema, so any database with that schema (a
+ * generated fixture, for instance) can be passed to rtcom_log_db_open().
+ */
+
+#ifndef __RTCOM_LOG_DB_H
+#define __RTCOM_LOG_DB_H
+
+#include <glib.h>
+
+#include "rtcom-log-event-batch.h"
+
+G_BEGIN_DECLS
+
+typedef struct _RTComLogDb RTComLogDb;
+
+/* The conditions the call list filters on. */
+typedef struct _RTComLogDbFilter RTComLogDbFilter;
+struct _RTComLogDbFilter
+{
+    /* Event type name, or NULL for any */
+    const gchar * event_type;
+    /* 0 or 1, or -1 for any direction */
+    gint outgoing;
+    /* Local account to match, or NULL for any */
+    const gchar * local_uid;
+    /* Match every local account but local_uid instead */
+    gboolean not_local_uid;
+    /* Only keep events started strictly between start_time and
+     * end_time */
+    gboolean by_date;
+    gint start_time;
+    gint end_time;
+};
+
+/**
+ * Returns the path of the event logger database of the current user.
+ * @return a newly allocated string
+ */
+gchar *
+rtcom_log_db_default_path(void);
+
+/**
+ * Opens the database read-only and prepares the call statement.
+ * @param path The database file
+ * @return a new #RTComLogDb, or NULL if the database couldn't be opened
+ * or doesn't have the expected schema
+ */
+RTComLogDb *
+rtcom_log_db_open(
+        const gchar * path);
+
+/**
+ * Closes the database.
+ * @param db The #RTComLogDb
+ */
+void
+rtcom_log_db_close(
+        RTComLogDb * db);
+
+/**
+ * Appends up to limit call events older than before_id to the batch,
+ * most recent first. Can be called from any thread.
+ * @param db The #RTComLogDb
+ * @param filter The conditions the events have to match
+ * @param before_id Only read events with a smaller id
+ * @param limit Maximum number of events to read
+ * @param batch The #RTComLogEventBatch to fill
+ * @return TRUE on success. On failure the batch is left as it was.
+ */
+gboolean
+rtcom_log_db_read_calls(
+        RTComLogDb * db,
+        const RTComLogDbFilter * filter,
+        gint before_id,
+        gint limit,
+        RTComLogEventBatch * batch);
+
+/**
+ * Gets the id of the most recent call event and the number of call
+ * events, whatever the filter. A call logged since changes the id and a
+ * deleted one changes the count, which makes the pair a cheap way to tell
+ * whether something saved from an earlier run is still current.
+ * @param db The #RTComLogDb
+ * @param newest_id Return location for the id, 0 if there are no calls
+ * @param n_calls Return location for the number of calls
+ * @return TRUE on success
+ */
+gboolean
+rtcom_log_db_get_call_stamp(
+        RTComLogDb * db,
+        gint * newest_id,
+        gint * n_calls);
+
+G_END_DECLS
+
+#endif
+
+/* vim: set ai et tw=75 ts=4 sw=4: */
@@ -0,0 +1,137 @@
+/* This file is part of Extended Call Log
+ *
+ * Copyright (C) 2010 Thom Troy
+ *
+ * WebTexter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License (GPL) as published by
+ * the Free Software Foundation
+ *
+ * WebTexter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Extended Call Log. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "rtcom-log-event-batch.h"
+
+#include <string.h>
+
+/* Most strings of a call event are short uids and names. */
+#define BATCH_STRING_CHUNK_SIZE 4096
+
+RTComLogEventBatch *
+rtcom_log_event_batch_new(
+        guint reserved)
+{
+    RTComLogEventBatch * batch = g_slice_new0(RTComLogEventBatch);
+
+    batch->events = g_array_sized_new(
+            FALSE, TRUE, sizeof(RTComLogEvent), reserved);
+    batch->strings = g_string_chunk_new(BATCH_STRING_CHUNK_SIZE);
+
+    return batch;
+}
+
+void
+rtcom_log_event_batch_free(
+        RTComLogEventBatch * batch)
+{
+    if (!batch)
+        return;
+
+    g_array_free(batch->events, TRUE);
+    g_string_chunk_free(batch->strings);
+    g_slice_free(RTComLogEventBatch, batch);
+}
+
+const gchar *
+rtcom_log_event_batch_strdup(
+        RTComLogEventBatch * batch,
+        const gchar * str)
+{
+    if (str == NULL)
+        return NULL;
+
+    return g_string_chunk_insert(batch->strings, str);
+}
+
+gboolean
+rtcom_log_event_batch_append_iter(
+        RTComLogEventBatch * batch,
+        RTComElIter * it)
+{
+    RTComLogEvent event;
+    gchar * service = NULL,
+          * group_uid = NULL,
+          * local_uid = NULL,
+          * remote_uid = NULL,
+          * remote_name = NULL,
+          * remote_ebook_uid = NULL,
+          * text = NULL,
+          * icon_name = NULL,
+          * group_title = NULL,
+          * event_type = NULL;
+
+    g_return_val_if_fail(batch != NULL, FALSE);
+    g_return_val_if_fail(it != NULL, FALSE);
+
+    memset(&event, 0, sizeof(RTComLogEvent));
+
+    /* rtcom_el_iter_get_values() reads straight into typed locations,
+     * so we don't pay for a GHashTable of GValues per row. */
+    if (!rtcom_el_iter_get_values(
+                it,
+                "id", &event.event_id,
+                "service", &service,
+                "group-uid", &group_uid,
+                "local-uid", &local_uid,
+                "remote-uid", &remote_uid,
+                "remote-name", &remote_name,
+                "remote-ebook-uid", &remote_ebook_uid,
+                "content", &text,
+                "icon-name", &icon_name,
+                "start-time", &event.timestamp,
+                "end-time", &event.end_timestamp,
+                "event-count", &event.count,
+                "group-title", &group_title,
+                "event-type", &event_type,
+                "outgoing", &event.outgoing,
+                "flags", &event.flags,
+                NULL))
+    {
+        g_warning("%s: couldn't read the event values", G_STRFUNC);
+        return FALSE;
+    }
+
+    event.service = g_intern_string(service);
+    event.group_uid = rtcom_log_event_batch_strdup(batch, group_uid);
+    event.local_uid = g_intern_string(local_uid);
+    event.remote_uid = rtcom_log_event_batch_strdup(batch, remote_uid);
+    event.remote_name = rtcom_log_event_batch_strdup(batch, remote_name);
+    event.remote_ebook_uid =
+        rtcom_log_event_batch_strdup(batch, remote_ebook_uid);
+    event.text = rtcom_log_event_batch_strdup(batch, text);
+    event.icon_name = rtcom_log_event_batch_strdup(batch, icon_name);
+    event.group_title = rtcom_log_event_batch_strdup(batch, group_title);
+    event.event_type = g_intern_string(event_type);
+
+    g_free(service);
+    g_free(group_uid);
+    g_free(local_uid);
+    g_free(remote_uid);
+    g_free(remote_name);
+    g_free(remote_ebook_uid);
+    g_free(text);
+    g_free(icon_name);
+    g_free(group_title);
+    g_free(event_type);
+
+    g_array_append_val(batch->events, event);
+
+    return TRUE;
+}
+
+/* vim: set ai et tw=75 ts=4 sw=4: */
@@ -0,0 +1,112 @@
+/* This file is part of Extended Call Log
+ *
+ * Copyright (C) 2010 Thom Troy
+ *
+ * WebTexter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License (GPL) as published by
+ * the Free Software Foundation
+ *
+ * WebTexter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Extended Call Log. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file rtcom-log-event-batch.h
+ * @brief A typed, contiguous batch of events read from the database.
+ *
+ * The loader fills a batch directly from an RTComElIter and the model
+ * stages it without any per-row hash tables or GValues. All the
+ * strings of a batch live in a single shared string chunk, so a batch
+ * is released with one call, except for the service, event type and
+ * local uid: those are interned, like the model columns they go to.
+ */
+
+#ifndef __RTCOM_LOG_EVENT_BATCH_H
+#define __RTCOM_LOG_EVENT_BATCH_H
+
+#include <glib.h>
+#include <rtcom-eventlogger/eventlogger.h>
+
+G_BEGIN_DECLS
+
+typedef struct _RTComLogEvent RTComLogEvent;
+struct _RTComLogEvent
+{
+    gint event_id;
+    const gchar * service;      /* interned */
+    const gchar * group_uid;
+    const gchar * local_uid;    /* interned */
+    const gchar * remote_uid;
+    const gchar * remote_name;
+    const gchar * remote_ebook_uid;
+    const gchar * text;
+    const gchar * icon_name;
+    gint timestamp;
+    gint end_timestamp;
+    gint count;
+    const gchar * group_title;
+    const gchar * event_type;   /* interned */
+    gboolean outgoing;
+    gint flags;
+};
+
+typedef struct _RTComLogEventBatch RTComLogEventBatch;
+struct _RTComLogEventBatch
+{
+    GArray * events;
+    GStringChunk * strings;
+};
+
+/**
+ * Creates a new, empty batch.
+ * @param reserved Number of events to preallocate room for
+ * @return a newly allocated #RTComLogEventBatch
+ */
+RTComLogEventBatch *
+rtcom_log_event_batch_new(
+        guint reserved);
+
+/**
+ * Frees the batch and all the strings it holds.
+ * @param batch The #RTComLogEventBatch
+ */
+void
+rtcom_log_event_batch_free(
+        RTComLogEventBatch * batch);
+
+/**
+ * Appends the event the iterator currently points at.
+ * @param batch The #RTComLogEventBatch
+ * @param it The #RTComElIter
+ * @return TRUE if the event could be read
+ */
+gboolean
+rtcom_log_event_batch_append_iter(
+        RTComLogEventBatch * batch,
+        RTComElIter * it);
+
+/**
+ * Copies a string into the batch string chunk.
+ * @param batch The #RTComLogEventBatch
+ * @param str The string to copy, or NULL
+ * @return the copy, owned by the batch, or NULL
+ */
+const gchar *
+rtcom_log_event_batch_strdup(
+        RTComLogEventBatch * batch,
+        const gchar * str);
+
+#define rtcom_log_event_batch_len(batch) ((batch)->events->len)
+#define rtcom_log_event_batch_index(batch, i) \
+    (&g_array_index((batch)->events, RTComLogEvent, (i)))
+
+G_END_DECLS
+
+#endif
+
+/* vim: set ai et tw=75 ts=4 sw=4: */
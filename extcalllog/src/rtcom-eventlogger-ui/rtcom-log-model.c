@@ -19,7 +19,10 @@
 
 #include "rtcom-log-model.h"
 #include "rtcom-log-columns.h"
+#include "rtcom-log-event-batch.h"
+#include "rtcom-log-phone-index.h"
 
+#include <stdlib.h>
 #include <string.h>
 #include <hildon/hildon.h>
 #include <gtk/gtk.h>
@@ -59,15 +62,104 @@ static void
 rtcom_log_model_finalize(
         GObject * obj);
 
+static void
+rtcom_log_model_tree_model_init(
+        GtkTreeModelIface * iface);
+
 static guint presence_need_redraw_signal_id = 0;
 static guint avatar_need_redraw_signal_id = 0;
+static guint bulk_insert_begin_signal_id = 0;
+static guint bulk_insert_end_signal_id = 0;
+
+static GtkTreeModelIface * parent_tree_model_iface = NULL;
+
+/* LOCAL_ACCOUNT, SERVICE and EVENT_TYPE repeat the same few values over
+ * and over, so the store keeps them as strings interned with
+ * g_intern_string() in G_TYPE_POINTER columns. Users of the model still
+ * see the G_TYPE_STRING columns of rtcom-log-columns.h; the model itself
+ * reads them with _row_interned(). */
+#define _column_is_interned(column) \
+    ((column) == RTCOM_LOG_VIEW_COL_LOCAL_ACCOUNT || \
+     (column) == RTCOM_LOG_VIEW_COL_SERVICE || \
+     (column) == RTCOM_LOG_VIEW_COL_EVENT_TYPE)
+
+static void
+_get_stored_value (
+        GtkTreeModel * tree_model,
+        GtkTreeIter * iter,
+        gint column,
+        GValue * value);
+
+/* The interned string of one of those columns, without a copy */
+static const gchar *
+_row_interned (RTComLogModel * model, GtkTreeIter * iter, gint column)
+{
+    GValue value = { 0 };
+    const gchar * str;
+
+    _get_stored_value(GTK_TREE_MODEL(model), iter, column, &value);
+    str = g_value_get_pointer(&value);
+    g_value_unset(&value);
+
+    return str;
+}
 
-G_DEFINE_TYPE(RTComLogModel, rtcom_log_model, GTK_TYPE_LIST_STORE);
+G_DEFINE_TYPE_WITH_CODE(RTComLogModel, rtcom_log_model, GTK_TYPE_LIST_STORE,
+        G_IMPLEMENT_INTERFACE(GTK_TYPE_TREE_MODEL,
+            rtcom_log_model_tree_model_init));
 #define RTCOM_LOG_MODEL_GET_PRIV(log_model) (G_TYPE_INSTANCE_GET_PRIVATE ((log_model), \
             RTCOM_LOG_MODEL_TYPE, RTComLogModelPrivate))
 
+/* Page sizes used until we know how long staging a row takes. Once we
+ * do, they adapt to the measured cost (see _cached_per_query()). */
 #define MAX_CACHED_PER_QUERY_FIRST 10
 #define MAX_CACHED_PER_QUERY 100
+#define MIN_CACHED_PER_QUERY 20
+
+/* Lazy loading of unlimited results: rows past the first page are
+ * staged as placeholders holding only their event id (stored negated
+ * to tell them apart), and their values are read from the database a
+ * page at a time when asked for, keeping at most PAGED_MAX_PAGES
+ * pages in memory. */
+#define PAGED_PAGE_SIZE 50
+#define PAGED_MAX_PAGES 20
+#define PAGED_SCAN_PER_QUERY 500
+/* Placeholders a search replaces with full rows per idle dispatch */
+#define MATERIALIZE_PER_IDLE PAGED_PAGE_SIZE
+
+/* Main loop time, in microseconds, staging may take per idle dispatch
+ * before giving the redraw a chance to run. */
+#define STAGING_BUDGET_US 8000
+/* How many idle dispatches worth of rows one background query fetches. */
+#define STAGING_SLICES_PER_QUERY 4
+/* How many batches the caching thread may read ahead of staging. */
+#define STAGING_QUEUE_MAX 4
+
+/* How long, in milliseconds, new-event signals are collected before
+ * the events are read together. */
+#define NEW_EVENTS_DELAY_MS 100
+
+/* How many of the collected new event ids go in a single query */
+#define NEW_EVENTS_PER_QUERY 32
+
+/* How often a populate waiting for an abandoned caching thread to let
+ * go of its query checks again */
+#define POPULATE_RETRY_MS 50
+
+/* How many of the most recent event ids of a group the model keeps to
+ * replace the row when its event is deleted. */
+#define GROUP_RECENT_IDS 8
+
+/* Refreshes of at most this many rows re-read them and update the store
+ * in place; larger ones reload it. */
+#define REFRESH_DIFF_MAX_ROWS 500
+
+/* How many rows the resolution idle resolves the contact of per run. */
+#define RESOLVE_ROWS_PER_IDLE 16
+
+/* How many events the purge thread reads per query while collecting
+ * the ids to delete. */
+#define PURGE_PAGE_SIZE 500
 
 #define AVATAR_IMAGE_BORDER { 0, 0, 0, 0 }
 
@@ -80,6 +172,28 @@ struct _RTComLogModelPrivate
     RTComElIter * current_iter;
     gchar ** filtered_services;
 
+    /* Seek paging: when query_func is set, the caching thread asks it
+     * for events older than the last one it read instead of using an
+     * offset. */
+    struct _query_func * query_func;
+
+    /* Reads the pages of query_func directly, if set. Taken by the next
+     * populate. */
+    RTComLogModelReadFunc read_func;
+
+    /* The current populate, NULL if cleared. Populating again abandons
+     * it: generation is bumped, with pipe_lock held, and its caching
+     * thread goes to abandoned_loads to be joined once it has noticed
+     * and exited. */
+    struct _load * load;
+    volatile gint generation;
+    GSList * abandoned_loads;
+
+    /* A caller's query an abandoned caching thread was still paging,
+     * populated by pending_populate_id once the thread has exited. */
+    RTComElQuery * pending_query;
+    guint pending_populate_id;
+
     /* Receive signals */
     gulong new_event_handler;
     gulong event_updated_handler;
@@ -88,11 +202,16 @@ struct _RTComLogModelPrivate
     gulong refresh_hint_handler;
 
     /* Caching stuff */
-    guint cached_n;
-    gboolean done_caching;
-    GThread * cache_thread;
-    GThread * pixbufs_thread;
-    gboolean cancel_threads;
+    /* Event id to the row showing it, as the GSequenceIter in the
+     * row's GtkTreeIter. Placeholder rows are in by their real id. */
+    GHashTable * rows_by_id;
+    /* The row standing for each group when grouping: by group uid,
+     * by (local uid, remote uid) pair and by abook uid. */
+    GHashTable * groups_by_uid;
+    GHashTable * groups_by_uids;
+    GHashTable * groups_by_contact;
+    /* group_stats_t of the rows of lists grouped by uids or contact */
+    GHashTable * group_stats;
     /* A hash table of <path, pixbuf> */
     GHashTable * cached_icons;
     GHashTable * cached_service_icons;
@@ -119,7 +238,25 @@ struct _RTComLogModelPrivate
                                    _already_ created our own aggregator. Don't
                                    mix it up with create_aggregator. */
     gboolean abook_aggregator_ready;
-    gboolean pixbufs_populated;
+
+    /* Uids of the contacts changed or removed since the last refresh,
+     * whose cached account data and rows are out of date. */
+    GHashTable * stale_contacts;
+    gulong contacts_added_handler;
+    gulong contacts_changed_handler;
+    gulong contacts_removed_handler;
+
+    /* The phone numbers of the contacts, once the aggregator is ready */
+    RTComLogPhoneIndex * phone_index;
+
+    /* Local and remote uid pairs, keyed like cached_account_data, that
+     * discovery found no contact for, to their remote uid. Address book
+     * changes drop the ones the changed contacts may have. */
+    GHashTable * unknown_contacts;
+    /* Rows resolution found no contact for, to their remote uid */
+    GHashTable * unresolved_rows;
+    guint discovery_hits;
+    guint discovery_misses;
 
     OssoABookAccountManager *account_manager;
     OssoABookWaitableClosure *accman_ready_closure;
@@ -133,18 +270,210 @@ struct _RTComLogModelPrivate
      * multiple refreshes. */
     guint refresh_id;
 
+    /* Rows inserted before their contact got resolved, as the
+     * GSequenceIter of their GtkTreeIter, to RESOLVE_QUEUED or
+     * RESOLVE_FIRST. Rows in the visible range also go to resolve_first,
+     * which resolve_id resolves before the rest. */
+    GHashTable * resolve_rows;
+    GQueue * resolve_first;
+    guint resolve_id;
+    /* The rows the view shows, see rtcom_log_model_set_visible_range();
+     * -1 when it doesn't tell. */
+    gint visible_first;
+    gint visible_last;
+    /* While resolve_id runs, the contacts whose rows need a row-changed,
+     * emitted once it's done instead of a scan per contact */
+    GHashTable * changed_contacts;
+
+    /* Ids of new events not staged yet, and the timeout staging them */
+    GArray * new_event_ids;
+    guint new_events_id;
+
     GConfClient *gconf_client;
     guint display_order_notify_id;
+
+    /* Load pipeline: the caching thread reads and decodes batches
+     * into staging_queue, at most STAGING_QUEUE_MAX of them, and the
+     * persistent staging_source stages them in order on the main loop.
+     * staging_queue and the pipe_ stats are shared with the thread and
+     * only touched with pipe_lock held. staging_current is the batch
+     * being staged, main thread only. */
+    GQueue * staging_queue;
+    struct _caching_data * staging_current;
+    GMutex * pipe_lock;
+    GCond * pipe_not_full;
+    GSource * staging_source;
+    GTimer * staging_timer;
+    GTimer * pipe_clock;
+    guint pipe_max_depth;
+    guint pipe_read_batches;
+    gdouble pipe_read_time;
+    guint pipe_staged_batches;
+    gdouble pipe_wait_time;
+    /* A service was purged from a limited list while batches of the
+     * load were still on their way; the list gets topped up once
+     * they're staged. */
+    gboolean purge_top_up;
+
+    /* Lazy loading, see PAGED_PAGE_SIZE. pages is most recently used
+     * first; paged_events maps event ids to their page. */
+    gboolean lazy_loading;
+    gboolean paged;
+    GQueue * pages;
+    GHashTable * paged_events;
+
+    /* Pages read with rows whose contact isn't known, which
+     * paged_discover_id discovers after whoever read the values is
+     * done with them. */
+    GQueue * pages_to_discover;
+    guint paged_discover_id;
+
+    /* Set while a search filter reads every row, see
+     * rtcom_log_model_set_searching(). materialize_id meanwhile replaces
+     * the placeholders older than materialize_before with full rows. */
+    gboolean searching;
+    guint materialize_id;
+    gint materialize_before;
+
+    /* The running rtcom_log_model_delete_matching(), if any */
+    struct _purge * purge;
+
+    /* Staging cost, read by the caching thread to size its pages. */
+    volatile gint row_cost_ns;
+    guint stats_rows;
+    gdouble stats_time;
+    gdouble stats_longest_stall;
 };
 
+/* The states of a row in resolve_rows */
+#define RESOLVE_QUEUED GINT_TO_POINTER(1)
+#define RESOLVE_FIRST GINT_TO_POINTER(2)
+
 typedef struct _caching_data caching_data_t;
 struct _caching_data
 {
-    GList * cached_events;
+    RTComLogEventBatch * batch;
     RTComLogModel * model;
     gboolean prepend;
+    /* The prepended rows stand in for rows removed just before */
+    gboolean replaces;
+    gboolean placeholders;
+    guint staged;
+    gdouble queued_at;
+};
+
+/* The query func and its data. Loads hold a reference, so the data
+ * stays around for a caching thread still winding down after the func
+ * got replaced. Main thread only. */
+typedef struct _query_func query_func_t;
+struct _query_func
+{
+    guint ref_count;
+    RTComLogModelQueryFunc func;
+    gpointer data;
+    GDestroyNotify destroy;
+};
+
+/* One populate of the model: everything its caching thread needs, so
+ * the thread never looks at settings the main thread may change under
+ * it. Freed by the main thread once the thread is joined. */
+typedef struct _load load_t;
+struct _load
+{
+    RTComLogModel * model;
+    guint generation;
+    GThread * thread;
+    volatile gint finished;
+
+    RTComEl * backend;
+    RTComElQuery * query;
+    query_func_t * query_func;
+    RTComLogModelReadFunc read_func;
+    RTComElQueryGroupBy group_by;
+    gint limit;
+    gboolean paged;
+    gboolean show_group_chat;
+
+    /* Where the next page starts. Only the caching thread touches them
+     * once it runs, but for the new events the main thread adds to
+     * cached_n. */
+    gint seek_id;
+    volatile gint cached_n;
+
+    /* The services deleted while it ran, whose events the batches it
+     * read before aren't staged. Main thread only. */
+    GSList * purged_services;
+};
+
+/* A rtcom_log_model_delete_matching() in progress. The thread reads the
+ * events through source, which only has what _read_before() needs and a
+ * ref on the model's RTComEl, and deletes them; the main thread reports
+ * progress from report_id. */
+typedef struct _purge purge_t;
+struct _purge
+{
+    RTComLogModel * model;
+    GThread * thread;
+    load_t source;
+    volatile gint cancelled;
+
+    /* Shared with the thread, only touched with lock held. deleted_ids
+     * are the ids deleted since the last report. */
+    GMutex * lock;
+    GArray * deleted_ids;
+    guint deleted;
+    guint total;
+    gboolean done;
+    GError * error;
+    guint report_id;
+
+    RTComLogModelDeleteFunc func;
+    gpointer data;
+};
+
+typedef struct _staging_source staging_source_t;
+struct _staging_source
+{
+    GSource source;
+    RTComLogModel * model;
+};
+
+typedef struct _paged_row paged_row_t;
+struct _paged_row
+{
+    GdkPixbuf * icon;
+    const GdkPixbuf * service_icon;
+    OssoABookContact * contact;
+};
+
+typedef struct _paged_page paged_page_t;
+struct _paged_page
+{
+    RTComLogEventBatch * batch;
+    paged_row_t * rows;
 };
 
+static caching_data_t *
+_caching_data_new (RTComLogModel * model, gboolean prepend, guint reserved)
+{
+    caching_data_t * d = g_slice_new0(caching_data_t);
+
+    d->batch = rtcom_log_event_batch_new(reserved);
+    d->model = model;
+    d->prepend = prepend;
+    return d;
+}
+
+static void
+_caching_data_free (caching_data_t * d)
+{
+    if (!d)
+        return;
+
+    rtcom_log_event_batch_free(d->batch);
+    g_slice_free(caching_data_t, d);
+}
+
 typedef struct _account_data account_data_t;
 struct _account_data
 {
@@ -195,27 +524,200 @@ _account_data_free (account_data_t * data)
     g_slice_free (account_data_t, data);
 }
 
+static query_func_t *
+_query_func_ref (query_func_t * query_func)
+{
+    if (query_func)
+        query_func->ref_count++;
+    return query_func;
+}
+
 static void
-_priv_cancel_and_join_threads (RTComLogModelPrivate *priv)
+_query_func_unref (query_func_t * query_func)
 {
-    priv->cancel_threads = TRUE;
+    if (!query_func || --query_func->ref_count > 0)
+        return;
+
+    if (query_func->destroy && query_func->data)
+        query_func->destroy (query_func->data);
+
+    g_slice_free (query_func_t, query_func);
+}
+
+static void
+_load_free (load_t * load)
+{
+    if (!load)
+        return;
+
+    if (load->query)
+        g_object_unref (load->query);
+    _query_func_unref (load->query_func);
+    g_slist_free (load->purged_services);
+
+    g_slice_free (load_t, load);
+}
+
+/* Whether a newer populate replaced the load. Safe from any thread. */
+static gboolean
+_load_is_stale (RTComLogModelPrivate *priv, load_t * load)
+{
+    return load->generation != (guint) g_atomic_int_get (&priv->generation);
+}
+
+static void
+_purge_free (purge_t * purge)
+{
+    g_thread_join (purge->thread);
+
+    /* The thread can't schedule another report anymore. */
+    if (purge->report_id)
+        g_source_remove (purge->report_id);
+
+    _query_func_unref (purge->source.query_func);
+    g_object_unref (purge->source.backend);
+    g_array_free (purge->deleted_ids, TRUE);
+    g_clear_error (&purge->error);
+    g_mutex_free (purge->lock);
+    g_slice_free (purge_t, purge);
+}
+
+/* Stops the running purge after the event it is deleting, without
+ * reporting it. */
+static void
+_priv_cancel_purge (RTComLogModelPrivate *priv)
+{
+    purge_t * purge = priv->purge;
+
+    if (!purge)
+        return;
+
+    priv->purge = NULL;
+    g_atomic_int_set (&purge->cancelled, TRUE);
+    _purge_free (purge);
+}
+
+/* Joins the abandoned caching threads that have exited already, or all
+ * of them with wait. */
+static void
+_priv_reap_loads (RTComLogModelPrivate *priv, gboolean wait)
+{
+    GSList * l, * next;
+
+    for (l = priv->abandoned_loads; l; l = next)
+    {
+        load_t * load = l->data;
+
+        next = l->next;
+        if (!wait && !g_atomic_int_get (&load->finished))
+            continue;
 
-    if(priv->cache_thread)
+        g_thread_join (load->thread);
+        _load_free (load);
+        priv->abandoned_loads =
+            g_slist_delete_link (priv->abandoned_loads, l);
+    }
+}
+
+/* Drops the current load without waiting for its caching thread: the
+ * thread only notices when it next checks the generation, which may be
+ * after a slow query, and nothing it reads from then on reaches the
+ * model. */
+static void
+_priv_abandon_load (RTComLogModelPrivate *priv)
+{
+    load_t * load = priv->load;
+
+    if (!load)
+        return;
+
+    priv->load = NULL;
+
+    /* The caching thread may be waiting for room in the queue. */
+    g_mutex_lock (priv->pipe_lock);
+    g_atomic_int_inc (&priv->generation);
+    g_cond_broadcast (priv->pipe_not_full);
+    g_mutex_unlock (priv->pipe_lock);
+
+    if (load->thread)
+        priv->abandoned_loads = g_slist_prepend (priv->abandoned_loads, load);
+    else
+        _load_free (load);
+
+    _priv_reap_loads (priv, FALSE);
+}
+
+/* Whether an abandoned caching thread still pages the query object */
+static gboolean
+_priv_query_in_use (RTComLogModelPrivate *priv, RTComElQuery *query)
+{
+    GSList * l;
+
+    _priv_reap_loads (priv, FALSE);
+
+    for (l = priv->abandoned_loads; l; l = l->next)
+    {
+        load_t * load = l->data;
+
+        if (load->query == query)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+static void
+_priv_cancel_pending_populate (RTComLogModelPrivate *priv)
+{
+    if (priv->pending_populate_id)
+    {
+        g_source_remove (priv->pending_populate_id);
+        priv->pending_populate_id = 0;
+    }
+
+    if (priv->pending_query)
     {
-        g_debug("%s: waiting for cache_thread to exit gracefully...",
-            G_STRFUNC);
-        g_thread_join(priv->cache_thread);
-        priv->cache_thread = NULL;
+        g_object_unref (priv->pending_query);
+        priv->pending_query = NULL;
     }
-    if(priv->pixbufs_thread)
+}
+
+/* Rows added to the top of the list shift the offsets the caching
+ * thread pages by. Loads seeking by event id don't page by offset, and
+ * their cached_n only counts what they read themselves. */
+static void
+_priv_skip_loaded (RTComLogModelPrivate *priv, gint n)
+{
+    load_t * load = priv->load;
+
+    if (!load ||
+        (load->query_func && load->group_by == RTCOM_EL_QUERY_GROUP_BY_NONE))
+        return;
+
+    g_atomic_int_add (&load->cached_n, n);
+}
+
+static void
+_priv_set_query_func (RTComLogModelPrivate *priv,
+    RTComLogModelQueryFunc func,
+    gpointer data,
+    GDestroyNotify destroy)
+{
+    _query_func_unref (priv->query_func);
+    priv->query_func = NULL;
+
+    if (!func)
     {
-        g_debug("%s: waiting for pixbufs_thread to exit gracefully...",
-            G_STRFUNC);
-        g_thread_join(priv->pixbufs_thread);
-        priv->pixbufs_thread = NULL;
+        if (destroy && data)
+            destroy (data);
+        return;
     }
 
-    priv->cancel_threads = FALSE;
+    priv->query_func = g_slice_new0 (query_func_t);
+    priv->query_func->ref_count = 1;
+    priv->query_func->func = func;
+    priv->query_func->data = data;
+    priv->query_func->destroy = destroy;
 }
 
 static gchar *
@@ -230,6 +732,14 @@ _account_data_generate_key(
 
 static const GdkPixbuf *_get_service_icon (RTComLogModel *model,
     const gchar *local_uid);
+static gint _row_event_id (GtkTreeModel *tree_model,
+    GtkTreeIter *iter);
+static gboolean _row_is_placeholder (GtkTreeModel *tree_model,
+    GtkTreeIter *iter);
+static void _paged_refresh (RTComLogModel *model);
+static void _top_up_purged (RTComLogModel *model);
+static void _index_group (RTComLogModel * model, GtkTreeIter * iter);
+static void _unindex_group (RTComLogModel * model, GtkTreeIter * iter);
 
 static gboolean
 _emit_row_changed_for_contact_slave (GtkTreeModel *model,
@@ -249,10 +759,41 @@ _emit_row_changed_for_contact_slave (GtkTreeModel *model,
     return FALSE;
 }
 
+static gboolean
+_emit_row_changed_for_contacts_slave (GtkTreeModel *model,
+    GtkTreePath *path, GtkTreeIter *iter, gpointer data)
+{
+    GHashTable *contacts = data;
+    OssoABookContact *current;
+
+    gtk_tree_model_get(model, iter, RTCOM_LOG_VIEW_COL_CONTACT, &current, -1);
+
+    if (current == NULL)
+        return FALSE;
+
+    if (g_hash_table_lookup (contacts, current))
+        g_signal_emit_by_name (model, "row-changed", path, iter);
+
+    g_object_unref (current);
+
+    return FALSE;
+}
+
 static void
 _emit_row_changed_for_contact (RTComLogModel *model,
     OssoABookContact *contact)
 {
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+
+    /* The resolution idle scans the model once for all of them */
+    if (priv->changed_contacts)
+    {
+        if (!g_hash_table_lookup (priv->changed_contacts, contact))
+            g_hash_table_insert (priv->changed_contacts,
+                g_object_ref (contact), contact);
+        return;
+    }
+
     gtk_tree_model_foreach (GTK_TREE_MODEL (model),
         _emit_row_changed_for_contact_slave, contact);
 }
@@ -437,6 +978,12 @@ new_discover_abook_contact (RTComLogModel *model, const char *local_uid,
 
     if (!strcmp (vcard_field, EVC_TEL))
       {
+        /* Every row from an unknown number gets here, so don't compare
+         * it with every number in the address book. */
+        if (priv->phone_index)
+            return g_strdup (rtcom_log_phone_index_lookup (
+                    priv->phone_index, remote_uid));
+
         contacts = osso_abook_aggregator_find_contacts_for_phone_number
             (OSSO_ABOOK_AGGREGATOR (priv->abook_aggregator), remote_uid, FALSE);
       }
@@ -485,8 +1032,34 @@ discover_abook_contact(
     gchar *remote_ebook_uid = NULL;
     RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
     GList *li;
+    gchar *key;
+
+    if (!remote_uid || !remote_uid[0])
+        return NULL;
+
+    /* Callers that aren't contacts keep calling */
+    key = _account_data_generate_key (local_uid, remote_uid);
+    if (g_hash_table_lookup (priv->unknown_contacts, key))
+    {
+        priv->discovery_hits++;
+        g_free (key);
+        return NULL;
+    }
+    priv->discovery_misses++;
 
-    return new_discover_abook_contact (model, local_uid, remote_uid);
+    remote_ebook_uid = new_discover_abook_contact (model, local_uid,
+        remote_uid);
+
+    /* Without the vcard field of the account nothing was looked up,
+     * which may change once the account manager is ready. */
+    if (!remote_ebook_uid &&
+        g_hash_table_lookup (priv->vcard_field_mapping, local_uid))
+        g_hash_table_insert (priv->unknown_contacts, key,
+            g_strdup (remote_uid));
+    else
+        g_free (key);
+
+    return remote_ebook_uid;
 
     g_return_val_if_fail (osso_abook_waitable_is_ready(
           OSSO_ABOOK_WAITABLE(priv->abook_aggregator), NULL), NULL);
@@ -553,77 +1126,6 @@ _get_contact_from_abook_uid (RTComLogModel *model, const gchar *abook_uid)
     return g_object_ref (c);
 }
 
-static void
-_remote_contact_discovery (RTComLogModel *model)
-{
-    RTComLogModelPrivate * priv;
-    GtkTreeIter iter;
-    gboolean valid;
-
-    g_debug("%s: discovering remote contacts if needed", G_STRFUNC);
-
-    priv = RTCOM_LOG_MODEL_GET_PRIV(model);
-
-    valid = gtk_tree_model_get_iter_first(GTK_TREE_MODEL(model), &iter);
-    while(valid)
-    {
-        gchar * local_uid, * remote_uid, * remote_ebook_uid;
-        OssoABookContact *c = NULL;
-        const gchar *name = NULL;
-
-        gtk_tree_model_get(
-                GTK_TREE_MODEL(model), &iter,
-                RTCOM_LOG_VIEW_COL_LOCAL_ACCOUNT, &local_uid,
-                RTCOM_LOG_VIEW_COL_REMOTE_ACCOUNT, &remote_uid,
-                RTCOM_LOG_VIEW_COL_ECONTACT_UID, &remote_ebook_uid,
-                RTCOM_LOG_VIEW_COL_CONTACT, &c,
-                -1);
-
-        if (c)
-        {
-            /* Already have it. */
-            g_object_unref (c);
-            goto cont;
-        }
-
-        if (!remote_ebook_uid)
-        {
-            /* Attempt to guess remote_ebook_uid if possible */
-            remote_ebook_uid = discover_abook_contact (model,
-                local_uid, remote_uid);
-
-            if (!remote_ebook_uid)
-                goto cont;
-
-        }
-
-        c = _get_contact_from_abook_uid(model, remote_ebook_uid);
-
-        if (!c)
-            goto cont;
-
-        name = osso_abook_contact_get_display_name (c);
-
-        /* If we've managed to get the contact object, we can
-         * safely store the abook id, contact object itself,
-         * and current display name. \o/ */
-        gtk_list_store_set (GTK_LIST_STORE(model), &iter,
-            RTCOM_LOG_VIEW_COL_CONTACT, c,
-            RTCOM_LOG_VIEW_COL_REMOTE_NAME, name,
-            RTCOM_LOG_VIEW_COL_ECONTACT_UID, remote_ebook_uid,
-            -1);
-
-        g_object_unref (c);
-
-cont:
-        g_free(local_uid);
-        g_free(remote_uid);
-        g_free(remote_ebook_uid);
-
-        valid = gtk_tree_model_iter_next (GTK_TREE_MODEL(model), &iter);
-    }
-}
-
 static account_data_t *
 _populate_pixbufs(
         RTComLogModel * model,
@@ -665,8 +1167,6 @@ _populate_pixbufs(
 
     g_free(caching_account_data_key);
 
-    priv->pixbufs_populated = TRUE;
-
     /* Using master contact instead the roster one here so
      * we can proprely _get_display_name(contact) later */
     if (account_data->contact == NULL)
@@ -695,641 +1195,2417 @@ _populate_pixbufs(
     return account_data;
 }
 
+/* Finds the contact of a row not having one yet and stores it, with its
+ * abook uid and display name, in the row. Rows left without one are
+ * kept in unresolved_rows, for the contacts added later. */
 static void
-_abook_aggregator_ready(
-      OssoABookWaitable *waitable,
-      const GError *error,
-      gpointer data)
+_resolve_row (RTComLogModel *model, GtkTreeIter *iter)
 {
-    RTComLogModel *model = RTCOM_LOG_MODEL(data);
     RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
-    GtkTreeModel *tm = GTK_TREE_MODEL(model);
+    const gchar * local_uid;
+    gchar * remote_uid, * remote_ebook_uid;
+    OssoABookContact *c = NULL;
+    gboolean resolved = TRUE;
+
+    local_uid = _row_interned(model, iter, RTCOM_LOG_VIEW_COL_LOCAL_ACCOUNT);
+    gtk_tree_model_get(
+            GTK_TREE_MODEL(model), iter,
+            RTCOM_LOG_VIEW_COL_REMOTE_ACCOUNT, &remote_uid,
+            RTCOM_LOG_VIEW_COL_ECONTACT_UID, &remote_ebook_uid,
+            RTCOM_LOG_VIEW_COL_CONTACT, &c,
+            -1);
 
-    g_debug ("%s: called", G_STRFUNC);
+    if (c)
+    {
+        /* Already have it. */
+        g_object_unref (c);
+        goto out;
+    }
 
-    priv->aggregator_ready_closure = NULL;
+    resolved = FALSE;
 
-    if (error)
-        return;
+    if (!remote_ebook_uid)
+    {
+        /* Attempt to guess remote_ebook_uid if possible */
+        remote_ebook_uid = discover_abook_contact (model,
+            local_uid, remote_uid);
 
-    g_debug ("%s: setting aggregator as READY", G_STRFUNC);
-    priv->abook_aggregator_ready = TRUE;
+        if (!remote_ebook_uid)
+            goto out;
+    }
 
-    _remote_contact_discovery (model);
+    c = _get_contact_from_abook_uid(model, remote_ebook_uid);
 
-    if (!priv->pixbufs_populated)
-    {
-        GtkTreeIter iter;
-        gboolean valid = gtk_tree_model_get_iter_first(tm, &iter);
+    if (!c)
+        goto out;
 
-        while(valid)
-        {
-            OssoABookContact *c = NULL;
-            gchar *local_uid, *remote_uid;
+    _populate_pixbufs (model, local_uid, remote_uid, c);
 
-            gtk_tree_model_get(tm, &iter,
-                    RTCOM_LOG_VIEW_COL_CONTACT, &c,
-                    RTCOM_LOG_VIEW_COL_LOCAL_ACCOUNT, &local_uid,
-                    RTCOM_LOG_VIEW_COL_REMOTE_ACCOUNT, &remote_uid,
-                    -1);
+    /* If we've managed to get the contact object, we can
+     * safely store the abook id, contact object itself,
+     * and current display name. \o/ */
+    _unindex_group (model, iter);
+    gtk_list_store_set (GTK_LIST_STORE(model), iter,
+        RTCOM_LOG_VIEW_COL_CONTACT, c,
+        RTCOM_LOG_VIEW_COL_REMOTE_NAME,
+            osso_abook_contact_get_display_name (c),
+        RTCOM_LOG_VIEW_COL_ECONTACT_UID, remote_ebook_uid,
+        -1);
+    _index_group (model, iter);
 
-            if (c)
-            {
-                _populate_pixbufs (model, local_uid, remote_uid, c);
-                g_object_unref (c);
-            }
+    g_object_unref (c);
+    resolved = TRUE;
 
-            g_free(local_uid);
-            g_free(remote_uid);
+out:
+    if (!resolved && local_uid && remote_uid)
+        g_hash_table_insert (priv->unresolved_rows, iter->user_data,
+            g_strdup (remote_uid));
 
-            valid = gtk_tree_model_iter_next(tm, &iter);
-        }
-    }
+    g_free(remote_uid);
+    g_free(remote_ebook_uid);
 }
 
 static gboolean
-_stage_cached (gpointer data)
+_resolve_idle (gpointer data)
 {
-    RTComLogModel * model = NULL;
-    RTComLogModelPrivate * priv = NULL;
-    caching_data_t * caching_data = data;
-    GList * events_iter = NULL;
+    RTComLogModel * model = RTCOM_LOG_MODEL(data);
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    gpointer rows[RESOLVE_ROWS_PER_IDLE];
+    GHashTableIter hash_iter;
+    GHashTable * changed_contacts;
+    GtkTreeIter iter;
+    gpointer row;
+    guint n = 0, i;
 
-    struct _staging_data
+    /* The ready handler schedules us again */
+    if (!priv->abook_aggregator_ready)
     {
-        GHashTable * values;
-        GtkTreePath * path;
-        GString * caching_account_data_key;
-        account_data_t * account_data;
+        priv->resolve_id = 0;
+        return FALSE;
+    }
 
-        gint event_id;
-        const gchar * service;
-        const gchar * group_uid;
-        const gchar * local_uid;
-        const gchar * remote_uid;
-        const gchar * remote_name;
-        const gchar * remote_ebook_uid;
-        const gchar * text;
-        const gchar * icon_name;
-        gint timestamp;
-        gint end_timestamp;
-        gint count;
-        const gchar * group_title;
-        const gchar * event_type;
-        gboolean outgoing;
-        gint flags;
-    } staging_data;
+    /* The rows in the visible range first */
+    while (n < RESOLVE_ROWS_PER_IDLE &&
+           (row = g_queue_pop_head (priv->resolve_first)) != NULL)
+    {
+        if (g_hash_table_remove (priv->resolve_rows, row))
+            rows[n++] = row;
+    }
+
+    g_hash_table_iter_init (&hash_iter, priv->resolve_rows);
+    while (n < RESOLVE_ROWS_PER_IDLE &&
+           g_hash_table_iter_next (&hash_iter, &row, NULL))
+    {
+        g_hash_table_iter_remove (&hash_iter);
+        rows[n++] = row;
+    }
+
+    /* Resolving emits row-changed, whose handlers may read the rows
+     * still in resolve_rows; so only once we're done going through it.
+     * The rows of the contacts it gets the presence and avatar of are
+     * changed together at the end. */
+    priv->changed_contacts = g_hash_table_new_full (g_direct_hash,
+        g_direct_equal, g_object_unref, NULL);
+    iter.stamp = GTK_LIST_STORE(model)->stamp;
+    for (i = 0; i < n; i++)
+    {
+        iter.user_data = rows[i];
+        _resolve_row (model, &iter);
+    }
+
+    changed_contacts = priv->changed_contacts;
+    priv->changed_contacts = NULL;
+    if (g_hash_table_size (changed_contacts) > 0)
+        gtk_tree_model_foreach (GTK_TREE_MODEL (model),
+            _emit_row_changed_for_contacts_slave, changed_contacts);
+    g_hash_table_destroy (changed_contacts);
+
+    if (g_hash_table_size (priv->resolve_rows) > 0)
+        return TRUE;
+
+    g_queue_clear (priv->resolve_first);
+    priv->resolve_id = 0;
+    return FALSE;
+}
+
+static void
+_schedule_resolve (RTComLogModel *model)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+
+    /* Alongside the staging, which has the same priority */
+    if (!priv->resolve_id && priv->abook_aggregator_ready &&
+        g_hash_table_size (priv->resolve_rows) > 0)
+        priv->resolve_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+            _resolve_idle, model, NULL);
+}
+
+/* Has a queued row resolved before the others */
+static void
+_resolve_first (RTComLogModelPrivate *priv, GtkTreeIter *iter)
+{
+    if (g_hash_table_lookup (priv->resolve_rows, iter->user_data) ==
+        RESOLVE_QUEUED)
+    {
+        g_hash_table_insert (priv->resolve_rows, iter->user_data,
+            RESOLVE_FIRST);
+        g_queue_push_tail (priv->resolve_first, iter->user_data);
+    }
+}
+
+/* Has the contact of the row resolved from the resolution idle, as soon
+ * as the aggregator is ready; first if the view shows it. */
+static void
+_queue_resolve (RTComLogModel *model, GtkTreeIter *iter)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+
+    g_hash_table_remove (priv->unresolved_rows, iter->user_data);
+    if (!g_hash_table_lookup (priv->resolve_rows, iter->user_data))
+        g_hash_table_insert (priv->resolve_rows, iter->user_data,
+            RESOLVE_QUEUED);
+
+    if (priv->visible_first >= 0)
+    {
+        GtkTreePath * path =
+            gtk_tree_model_get_path (GTK_TREE_MODEL (model), iter);
+        gint i = gtk_tree_path_get_indices (path)[0];
+
+        if (i >= priv->visible_first && i <= priv->visible_last)
+            _resolve_first (priv, iter);
+        gtk_tree_path_free (path);
+    }
+
+    _schedule_resolve (model);
+}
+
+static void
+_drop_resolve_queue (RTComLogModelPrivate *priv)
+{
+    g_hash_table_remove_all (priv->resolve_rows);
+    g_queue_clear (priv->resolve_first);
+    if (priv->resolve_id)
+    {
+        g_source_remove (priv->resolve_id);
+        priv->resolve_id = 0;
+    }
+}
+
+static void
+_build_phone_index (RTComLogModel *model)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    GList *contacts, *l;
+
+    rtcom_log_phone_index_free (priv->phone_index);
+    priv->phone_index = rtcom_log_phone_index_new ();
+
+    contacts = osso_abook_aggregator_list_master_contacts (
+        OSSO_ABOOK_AGGREGATOR (priv->abook_aggregator));
+    for (l = contacts; l; l = l->next)
+        rtcom_log_phone_index_add_contact (priv->phone_index, l->data);
+    g_list_free (contacts);
+}
+
+static void
+_abook_aggregator_ready(
+      OssoABookWaitable *waitable,
+      const GError *error,
+      gpointer data)
+{
+    RTComLogModel *model = RTCOM_LOG_MODEL(data);
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+
+    g_debug ("%s: called", G_STRFUNC);
+
+    priv->aggregator_ready_closure = NULL;
+
+    if (error)
+        return;
+
+    g_debug ("%s: setting aggregator as READY", G_STRFUNC);
+    priv->abook_aggregator_ready = TRUE;
+
+    _build_phone_index (model);
+    g_hash_table_remove_all (priv->unknown_contacts);
+
+    /* Only the rows staged while we waited need their contact */
+    _schedule_resolve (model);
+    _paged_refresh (model);
+}
+
+static GdkPixbuf *
+_lookup_icon (RTComLogModelPrivate * priv, const gchar * icon_name)
+{
+    GdkPixbuf * icon;
+
+    if(!icon_name)
+        return NULL;
+
+    icon = g_hash_table_lookup(priv->cached_icons, icon_name);
+    if(!icon)
+    {
+        icon = gtk_icon_theme_load_icon(
+                gtk_icon_theme_get_default(),
+                icon_name,
+                RTCOM_LOG_VIEW_ICON_SIZE,
+                0, NULL);
+        if(icon)
+            g_hash_table_insert(
+                    priv->cached_icons,
+                    g_strdup(icon_name),
+                    icon);
+    }
+
+    return icon;
+}
+
+/* What the model knows of the events of a group: how many there are,
+ * -1 if it doesn't know, and the ids of the most recent ones, the
+ * row's own first. */
+typedef struct _group_stats group_stats_t;
+struct _group_stats
+{
+    gint count;
+    gint recent[GROUP_RECENT_IDS];
+    guint n_recent;
+};
+
+static void
+_group_stats_free (gpointer stats)
+{
+    g_slice_free(group_stats_t, stats);
+}
+
+/* A key of priv->groups_by_uids. The local uid is interned, the keys
+ * of the index own their remote uid. */
+typedef struct _uid_pair uid_pair_t;
+struct _uid_pair
+{
+    const gchar * local_uid;
+    gchar * remote_uid;
+};
+
+static guint
+_uid_pair_hash (gconstpointer key)
+{
+    const uid_pair_t * pair = key;
+
+    return g_direct_hash(pair->local_uid) * 31 +
+        g_str_hash(pair->remote_uid);
+}
+
+static gboolean
+_uid_pair_equal (gconstpointer a, gconstpointer b)
+{
+    const uid_pair_t * pair_a = a, * pair_b = b;
+
+    return pair_a->local_uid == pair_b->local_uid &&
+        strcmp(pair_a->remote_uid, pair_b->remote_uid) == 0;
+}
+
+static void
+_uid_pair_free (gpointer key)
+{
+    uid_pair_t * pair = key;
+
+    g_free(pair->remote_uid);
+    g_slice_free(uid_pair_t, pair);
+}
+
+/* GtkListStore iters persist, so the indexes keep the one of each row
+ * until the row is removed. Rows must only be removed, and event ids
+ * and grouping columns only changed, through the helpers below to keep
+ * them right. */
+static void
+_index_row (RTComLogModelPrivate * priv, GtkTreeIter * iter, gint event_id)
+{
+    g_hash_table_insert(priv->rows_by_id,
+            GINT_TO_POINTER(ABS(event_id)), iter->user_data);
+}
+
+static void
+_unindex_row (RTComLogModel * model, GtkTreeIter * iter)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    gpointer key = GINT_TO_POINTER(
+            ABS(_row_event_id(GTK_TREE_MODEL(model), iter)));
+
+    /* A newer row may have taken the id over */
+    if(g_hash_table_lookup(priv->rows_by_id, key) == iter->user_data)
+        g_hash_table_remove(priv->rows_by_id, key);
+}
+
+/* Makes the row the one standing for its group. Only grouped lists are
+ * indexed, so lazily loaded rows never get here. */
+static void
+_index_group (RTComLogModel * model, GtkTreeIter * iter)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    const gchar * local_uid;
+    gchar * remote_uid = NULL, * group_uid = NULL, * ebook_uid = NULL;
+
+    if(priv->group_by == RTCOM_EL_QUERY_GROUP_BY_NONE)
+        return;
+
+    local_uid = _row_interned(model, iter, RTCOM_LOG_VIEW_COL_LOCAL_ACCOUNT);
+    gtk_tree_model_get(
+            GTK_TREE_MODEL(model), iter,
+            RTCOM_LOG_VIEW_COL_REMOTE_ACCOUNT, &remote_uid,
+            RTCOM_LOG_VIEW_COL_ECONTACT_UID, &ebook_uid,
+            RTCOM_LOG_VIEW_COL_GROUP_UID, &group_uid,
+            -1);
+
+    if(priv->group_by == RTCOM_EL_QUERY_GROUP_BY_GROUP && group_uid)
+    {
+        g_hash_table_insert(priv->groups_by_uid, group_uid,
+                iter->user_data);
+        group_uid = NULL;
+    }
+
+    if(priv->group_by == RTCOM_EL_QUERY_GROUP_BY_CONTACT && ebook_uid)
+    {
+        g_hash_table_insert(priv->groups_by_contact, ebook_uid,
+                iter->user_data);
+        ebook_uid = NULL;
+    }
+
+    if((priv->group_by == RTCOM_EL_QUERY_GROUP_BY_UIDS ||
+        priv->group_by == RTCOM_EL_QUERY_GROUP_BY_CONTACT) &&
+       local_uid && remote_uid)
+    {
+        uid_pair_t * pair = g_slice_new(uid_pair_t);
+
+        pair->local_uid = local_uid;
+        pair->remote_uid = remote_uid;
+        g_hash_table_insert(priv->groups_by_uids, pair, iter->user_data);
+        remote_uid = NULL;
+    }
+
+    g_free(remote_uid);
+    g_free(group_uid);
+    g_free(ebook_uid);
+}
+
+static void
+_unindex_key (GHashTable * index, gconstpointer key, GtkTreeIter * iter)
+{
+    if(key && g_hash_table_lookup(index, key) == iter->user_data)
+        g_hash_table_remove(index, key);
+}
+
+static void
+_unindex_group (RTComLogModel * model, GtkTreeIter * iter)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    uid_pair_t pair = { NULL, NULL };
+    gchar * group_uid = NULL, * ebook_uid = NULL;
+
+    /* Also keeps ungrouped lists from reading lazily loaded rows */
+    if(g_hash_table_size(priv->groups_by_uid) == 0 &&
+       g_hash_table_size(priv->groups_by_uids) == 0 &&
+       g_hash_table_size(priv->groups_by_contact) == 0)
+        return;
+
+    pair.local_uid = _row_interned(model, iter,
+            RTCOM_LOG_VIEW_COL_LOCAL_ACCOUNT);
+    gtk_tree_model_get(
+            GTK_TREE_MODEL(model), iter,
+            RTCOM_LOG_VIEW_COL_REMOTE_ACCOUNT, &pair.remote_uid,
+            RTCOM_LOG_VIEW_COL_ECONTACT_UID, &ebook_uid,
+            RTCOM_LOG_VIEW_COL_GROUP_UID, &group_uid,
+            -1);
+
+    _unindex_key(priv->groups_by_uid, group_uid, iter);
+    _unindex_key(priv->groups_by_contact, ebook_uid, iter);
+    if(pair.local_uid && pair.remote_uid)
+        _unindex_key(priv->groups_by_uids, &pair, iter);
+
+    g_free(pair.remote_uid);
+    g_free(group_uid);
+    g_free(ebook_uid);
+}
+
+static gboolean
+_lookup_index (RTComLogModel * model, GHashTable * index,
+        gconstpointer key, GtkTreeIter * iter)
+{
+    gpointer row = key ? g_hash_table_lookup(index, key) : NULL;
+
+    if(!row)
+        return FALSE;
+
+    iter->stamp = GTK_LIST_STORE(model)->stamp;
+    iter->user_data = row;
+    return TRUE;
+}
+
+static gboolean
+_last_row (RTComLogModel * model, GtkTreeIter * iter)
+{
+    gint n = GTK_LIST_STORE(model)->length;
+
+    return n > 0 && gtk_tree_model_iter_nth_child(GTK_TREE_MODEL(model),
+            iter, NULL, n - 1);
+}
+
+static gboolean
+_lookup_row (RTComLogModel * model, gint event_id, GtkTreeIter * iter)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+
+    return _lookup_index(model, priv->rows_by_id,
+            GINT_TO_POINTER(event_id), iter);
+}
+
+static gboolean
+_lookup_uid_pair (
+        RTComLogModel * model,
+        const gchar * local_uid,
+        const gchar * remote_uid,
+        GtkTreeIter * iter)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    uid_pair_t pair;
+
+    if(!local_uid || !remote_uid)
+        return FALSE;
+
+    pair.local_uid = g_intern_string(local_uid);
+    pair.remote_uid = (gchar *) remote_uid;
+    return _lookup_index(model, priv->groups_by_uids, &pair, iter);
+}
+
+/* Finds the row standing for the group of the given uids, as the
+ * current grouping defines it. */
+static gboolean
+_lookup_group (
+        RTComLogModel * model,
+        const gchar * local_uid,
+        const gchar * remote_uid,
+        const gchar * remote_ebook_uid,
+        const gchar * group_uid,
+        GtkTreeIter * iter)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+
+    switch(priv->group_by)
+    {
+        case RTCOM_EL_QUERY_GROUP_BY_GROUP:
+            return _lookup_index(model, priv->groups_by_uid, group_uid,
+                    iter);
+
+        case RTCOM_EL_QUERY_GROUP_BY_CONTACT:
+            return _lookup_index(model, priv->groups_by_contact,
+                    remote_ebook_uid, iter);
+
+        case RTCOM_EL_QUERY_GROUP_BY_UIDS:
+            return _lookup_uid_pair(model, local_uid, remote_uid, iter);
+
+        default:
+            return FALSE;
+    }
+}
+
+/* Like gtk_list_store_remove(), iter moves to the next row. */
+static gboolean
+_remove_row (RTComLogModel * model, GtkTreeIter * iter)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+
+    _unindex_row(model, iter);
+    _unindex_group(model, iter);
+    g_hash_table_remove(priv->group_stats, iter->user_data);
+    g_hash_table_remove(priv->resolve_rows, iter->user_data);
+    g_hash_table_remove(priv->unresolved_rows, iter->user_data);
+    return gtk_list_store_remove(GTK_LIST_STORE(model), iter);
+}
+
+static void
+_clear_rows (RTComLogModel * model)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+
+    g_hash_table_remove_all(priv->rows_by_id);
+    g_hash_table_remove_all(priv->groups_by_uid);
+    g_hash_table_remove_all(priv->groups_by_uids);
+    g_hash_table_remove_all(priv->groups_by_contact);
+    g_hash_table_remove_all(priv->group_stats);
+    g_hash_table_remove_all(priv->unresolved_rows);
+    _drop_resolve_queue(priv);
+    gtk_list_store_clear(GTK_LIST_STORE(model));
+}
+
+/* Whether the event gets a row. Doesn't touch anything but the event,
+ * so it's safe to call from the caching thread. */
+static gboolean
+_keep_event (gboolean show_group_chat, RTComLogEvent * event)
+{
+    /* if requested, ignore groupchat events */
+    if (!show_group_chat &&
+        (event->flags & RTCOM_EL_FLAG_CHAT_GROUP) &&
+        event->service == g_intern_static_string ("RTCOM_EL_SERVICE_CHAT"))
+    {
+        /* this is ugly; some protocols use normal remote uids of contacts
+         * even for groupchat messages (notably, skype); if we ignore
+         * those and grouping is by uids or contact, we won't show *any*
+         * messages (incl. non-groupchat-ones) from that contact, because
+         * the database gave us only this row; in this
+         * case it's prefferable that we treat the groupchat message as
+         * a normal one; so, if abook euid of the contact is known, we'll
+         * treat the message as a normal one instead. otherwise, we ignore
+         * it. */
+        if (event->remote_ebook_uid)
+          {
+            event->flags &= ~RTCOM_EL_FLAG_CHAT_GROUP;
+          }
+        else
+          {
+            return FALSE;
+          }
+    }
+
+    return TRUE;
+}
+
+/* The decode stage of the pipeline: drops the events that won't get a
+ * row before the batch is queued, so the main loop doesn't see them.
+ * Contacts and icons can only be resolved on the main thread. */
+static void
+_decode_batch (load_t * load, RTComLogEventBatch * batch)
+{
+    guint i, kept = 0;
+
+    for(i = 0; i < rtcom_log_event_batch_len(batch); i++)
+    {
+        RTComLogEvent * event = rtcom_log_event_batch_index(batch, i);
+
+        if(!_keep_event(load->show_group_chat, event))
+            continue;
+
+        if(kept != i)
+            *rtcom_log_event_batch_index(batch, kept) = *event;
+        kept++;
+    }
+
+    g_array_set_size(batch->events, kept);
+}
+
+/* Inserts the row of the event at position. A discovered abook uid is
+ * kept in the event, with its string in the batch. */
+static void
+_insert_event_row (RTComLogModel * model, RTComLogEventBatch * batch,
+        RTComLogEvent * event, gint position, GtkTreeIter * iter)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    account_data_t * account_data = NULL;
+    OssoABookContact * contact = NULL;
+    const gchar * remote_name = NULL;
+    GdkPixbuf * icon = NULL;
+    const GdkPixbuf * service_icon;
+    gboolean resolve_later = FALSE;
+
+    icon = _lookup_icon(priv, event->icon_name);
+
+    service_icon = _get_service_icon (model, event->local_uid);
+
+    /* Grouping by contact needs the abook uid to find the group, so
+     * resolve the contact before inserting there. Elsewhere the row
+     * goes in with what the event has, unless we know the contact of
+     * its uids already, and gets its contact from the resolution idle. */
+    if(priv->abook_aggregator_ready &&
+       priv->group_by != RTCOM_EL_QUERY_GROUP_BY_CONTACT)
+    {
+        gchar * key = _account_data_generate_key(event->local_uid,
+                event->remote_uid);
+
+        account_data = g_hash_table_lookup(priv->cached_account_data, key);
+        g_free(key);
+
+        if(account_data && account_data->contact)
+        {
+            contact = g_object_ref(account_data->contact);
+            if(!event->remote_ebook_uid)
+                event->remote_ebook_uid = rtcom_log_event_batch_strdup(batch,
+                        osso_abook_contact_get_persistent_uid(contact));
+        }
+        else
+        {
+            account_data = NULL;
+            resolve_later = event->local_uid && event->remote_uid;
+        }
+    }
+    else if(priv->abook_aggregator_ready)
+    {
+        /* Attempt to guess remote_ebook_uid if possible */
+        if (!event->remote_ebook_uid &&
+            event->local_uid &&
+            event->remote_uid)
+        {
+            gchar * discovered = discover_abook_contact (model,
+                event->local_uid,
+                event->remote_uid);
+
+            /* Keep the discovered uid in the batch so it gets freed
+             * afterwards, with the rest of the strings. */
+            event->remote_ebook_uid =
+                rtcom_log_event_batch_strdup (batch, discovered);
+            g_free (discovered);
+        }
+
+        contact = _get_contact_from_abook_uid (model,
+            event->remote_ebook_uid);
+
+        /* If we find the contact, store it and its display name
+         * and call populate pixbufs on it. This mirrors _resolve_row,
+         * which only works on rows already in the store; going through
+         * it would insert the row and then change it again. */
+        if (contact)
+        {
+            remote_name = osso_abook_contact_get_display_name (contact);
+
+            account_data = _populate_pixbufs(
+                    model,
+                    event->local_uid,
+                    event->remote_uid,
+                    contact);
+        }
+    }
+    else
+    {
+        g_debug(G_STRLOC ": couldn't find contact because the aggregator is not ready.");
+        resolve_later = event->local_uid && event->remote_uid;
+    }
+
+    if (account_data && account_data->contact)
+      {
+        const gchar *name =
+            osso_abook_contact_get_display_name
+                (account_data->contact);
+
+        if (name != NULL)
+            remote_name = name;
+      }
+
+    if (remote_name == NULL)
+        remote_name = event->remote_name;
+
+    gtk_list_store_insert_with_values(
+            GTK_LIST_STORE(model),
+            iter,
+            position,
+
+            RTCOM_LOG_VIEW_COL_ICON,           icon,
+            RTCOM_LOG_VIEW_COL_EVENT_ID,       event->event_id,
+            RTCOM_LOG_VIEW_COL_SERVICE,        event->service,
+            RTCOM_LOG_VIEW_COL_GROUP_UID,      event->group_uid,
+
+            RTCOM_LOG_VIEW_COL_LOCAL_ACCOUNT,  event->local_uid,
+            RTCOM_LOG_VIEW_COL_REMOTE_ACCOUNT, event->remote_uid,
+            RTCOM_LOG_VIEW_COL_REMOTE_NAME,    remote_name,
+            RTCOM_LOG_VIEW_COL_ECONTACT_UID,   event->remote_ebook_uid,
+
+            RTCOM_LOG_VIEW_COL_TEXT,           event->text,
+            RTCOM_LOG_VIEW_COL_TIMESTAMP,      event->timestamp,
+            RTCOM_LOG_VIEW_COL_END_TIMESTAMP,   event->end_timestamp,
+            RTCOM_LOG_VIEW_COL_COUNT,          event->count,
+            RTCOM_LOG_VIEW_COL_GROUP_TITLE,    event->group_title,
+            RTCOM_LOG_VIEW_COL_EVENT_TYPE,     event->event_type,
+            RTCOM_LOG_VIEW_COL_OUTGOING,       event->outgoing,
+            RTCOM_LOG_VIEW_COL_FLAGS,          event->flags,
+            RTCOM_LOG_VIEW_COL_CONTACT,        contact,
+            RTCOM_LOG_VIEW_COL_SERVICE_ICON,   service_icon,
+
+            -1);
+
+    if (contact)
+        g_object_unref (contact);
+    else if (priv->abook_aggregator_ready && !resolve_later &&
+             event->local_uid && event->remote_uid)
+        g_hash_table_insert (priv->unresolved_rows, iter->user_data,
+            g_strdup (event->remote_uid));
+
+    _index_row(priv, iter, event->event_id);
+
+    if (resolve_later)
+        _queue_resolve(model, iter);
+}
+
+/* The position at or after first where a row for event_id keeps the
+ * rows in descending id order, found by bisecting them. */
+static gint
+_sorted_position (RTComLogModel * model, gint event_id, gint first)
+{
+    GtkTreeModel * tm = GTK_TREE_MODEL(model);
+    gint lo = first, hi = GTK_LIST_STORE(model)->length;
+
+    while(lo < hi)
+    {
+        gint mid = lo + (hi - lo) / 2;
+        GtkTreeIter iter;
+
+        gtk_tree_model_iter_nth_child(tm, &iter, NULL, mid);
+        if(ABS(_row_event_id(tm, &iter)) > event_id)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/* Moves the row down past the rows more recent than event_id, its new
+ * id. */
+static void
+_move_to_sorted (RTComLogModel * model, GtkTreeIter * iter, gint event_id)
+{
+    GtkTreeModel * tm = GTK_TREE_MODEL(model);
+    GtkTreeIter position_iter;
+    GtkTreePath * path;
+    gint index, position;
+
+    path = gtk_tree_model_get_path(tm, iter);
+    index = gtk_tree_path_get_indices(path)[0];
+    gtk_tree_path_free(path);
+
+    position = _sorted_position(model, event_id, index + 1);
+    if(position == index + 1)
+        return;
+
+    g_debug(G_STRLOC ": move it down!");
+    if(gtk_tree_model_iter_nth_child(tm, &position_iter, NULL, position))
+        gtk_list_store_move_before(GTK_LIST_STORE(model), iter,
+                &position_iter);
+    else
+        gtk_list_store_move_before(GTK_LIST_STORE(model), iter, NULL);
+}
+
+/* Records the event as the most recent of the group of its row. stats
+ * are the ones of the row it replaces, if any. Loaded rows come with
+ * the number of events of their group. */
+static void
+_track_group (RTComLogModelPrivate * priv, GtkTreeIter * iter,
+        RTComLogEvent * event, group_stats_t * stats, gboolean loaded)
+{
+    if(priv->group_by != RTCOM_EL_QUERY_GROUP_BY_UIDS &&
+       priv->group_by != RTCOM_EL_QUERY_GROUP_BY_CONTACT)
+    {
+        if(stats)
+            _group_stats_free(stats);
+        return;
+    }
+
+    if(!stats)
+    {
+        stats = g_slice_new0(group_stats_t);
+        stats->count = loaded ? event->count : -1;
+    }
+    else if(stats->count >= 0)
+        stats->count++;
+
+    if(stats->n_recent == GROUP_RECENT_IDS)
+        stats->n_recent--;
+    g_memmove(stats->recent + 1, stats->recent,
+            stats->n_recent * sizeof(gint));
+    stats->recent[0] = event->event_id;
+    stats->n_recent++;
+
+    g_hash_table_insert(priv->group_stats, iter->user_data, stats);
+}
+
+static group_stats_t *
+_steal_group_stats (RTComLogModelPrivate * priv, GtkTreeIter * iter)
+{
+    group_stats_t * stats = g_hash_table_lookup(priv->group_stats,
+            iter->user_data);
+
+    if(stats)
+        g_hash_table_steal(priv->group_stats, iter->user_data);
+
+    return stats;
+}
+
+/* Stages the events of caching_data not staged yet. With a non-zero
+ * budget, it stops once priv->staging_timer goes past it and returns
+ * FALSE; caching_data->staged tells where to resume. */
+static gboolean
+_stage_cached (caching_data_t * caching_data, gdouble budget)
+{
+    RTComLogModel * model = NULL;
+    RTComLogModelPrivate * priv = NULL;
+    RTComLogEventBatch * batch = caching_data->batch;
+    guint i;
 
     GtkTreeIter iter, deletion_iter;
-    gchar * deletion_group_uid = NULL,
-          * deletion_ebook_uid = NULL,
-          * deletion_local_uid = NULL,
-          * deletion_remote_uid = NULL;
+    group_stats_t * stats;
+
+    model = caching_data->model;
+    priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+
+    for(i = caching_data->staged; i < rtcom_log_event_batch_len(batch); i++)
+    {
+        RTComLogEvent * event = rtcom_log_event_batch_index(batch, i);
+        gboolean replaced = caching_data->replaces;
+
+        if(budget > 0 && i > caching_data->staged &&
+           g_timer_elapsed(priv->staging_timer, NULL) >= budget)
+        {
+            caching_data->staged = i;
+            return FALSE;
+        }
+
+        if (!_keep_event (priv->show_group_chat, event))
+            continue;
+
+        /* Appended rows past the limit would only be trimmed again */
+        if (!caching_data->prepend && priv->limit != -1 &&
+            GTK_LIST_STORE(model)->length >= priv->limit)
+            continue;
+
+        g_debug("Staging event:\n\tid: %d\n\tservice: %s\n\tgroup_uid: %s\n\tlocal_uid: %s\n\tremote_uid: %s\n\t"
+                "remote_name: %s\n\tremote_ebook_uid: %s\n\ttext: %s\n\ticon_name: %s\n\t"
+                "timestamp: %d\n\tend_timestamp: %d\n\tevents in group: %d\n\tgroup title: %s\n\tevent type: %s\n\t"
+                "outgoing: %s\n\t flags: %d\n",
+                event->event_id,
+                event->service,
+                event->group_uid,
+                event->local_uid,
+                event->remote_uid,
+                event->remote_name,
+                event->remote_ebook_uid,
+                event->text,
+                event->icon_name,
+                event->timestamp,
+                event->end_timestamp,
+                event->count,
+                event->group_title,
+                event->event_type,
+                event->outgoing ? "yes" : "no",
+                event->flags);
+
+        /* A search would read them all right away */
+        if(caching_data->placeholders && !priv->searching)
+        {
+            gtk_list_store_insert_with_values(
+                    GTK_LIST_STORE(model),
+                    &iter,
+                    GTK_LIST_STORE(model)->length,
+                    RTCOM_LOG_VIEW_COL_EVENT_ID, -event->event_id,
+                    -1);
+            _index_row(priv, &iter, event->event_id);
+            continue;
+        }
+
+        /* Prepended events aren't always the most recent ones, e.g. the
+         * one standing for a group again after a deletion. */
+        _insert_event_row(model, batch, event,
+                caching_data->prepend ?
+                    _sorted_position(model, event->event_id, 0) :
+                    GTK_LIST_STORE(model)->length,
+                &iter);
+
+        /**
+         * Now let's figure out if this new event that we just added,
+         * belongs to an existing group. Of course this can only be if
+         * we're adding a single new event, so that caching_data->prepend
+         * will be TRUE.
+         * If this is the case, we just need to delete the old row
+         * representing the group.
+         */
+        stats = NULL;
+        if(caching_data->prepend &&
+           _lookup_group(model, event->local_uid, event->remote_uid,
+               event->remote_ebook_uid, event->group_uid, &deletion_iter))
+        {
+            g_debug(G_STRLOC ": we found the old group, let's delete it.");
+            stats = _steal_group_stats(priv, &deletion_iter);
+            _remove_row(model, &deletion_iter);
+            replaced = TRUE;
+        }
+        else if(caching_data->prepend &&
+                priv->group_by == RTCOM_EL_QUERY_GROUP_BY_CONTACT &&
+                _lookup_uid_pair(model, event->local_uid, event->remote_uid,
+                    &deletion_iter))
+        {
+            g_debug(G_STRLOC ": we found the old entry for this contacts pair, let's delete it.");
+            stats = _steal_group_stats(priv, &deletion_iter);
+            _remove_row(model, &deletion_iter);
+            replaced = TRUE;
+        }
+
+        /* A group moving to the top was loaded already */
+        if(caching_data->prepend && !replaced)
+            _priv_skip_loaded(priv, 1);
+
+        _index_group(model, &iter);
+        _track_group(priv, &iter, event, stats, !caching_data->prepend);
+
+        /* New events are read ungrouped, so the group they join has the
+         * count, when we know it. */
+        stats = caching_data->prepend ?
+            g_hash_table_lookup(priv->group_stats, iter.user_data) : NULL;
+        if(stats && stats->count > 0)
+            gtk_list_store_set(GTK_LIST_STORE(model), &iter,
+                    RTCOM_LOG_VIEW_COL_COUNT, stats->count,
+                    -1);
+
+        /* If we ended up with more events than we should show, trim the
+         * last one. Each event adds a row at most, so that's enough. */
+        if (priv->limit != -1 &&
+            GTK_LIST_STORE(model)->length > priv->limit &&
+            _last_row(model, &deletion_iter))
+        {
+            _remove_row(model, &deletion_iter);
+        }
+    }
+
+    caching_data->staged = i;
+
+    return TRUE;
+}
+
+static void
+_record_staging (RTComLogModelPrivate * priv, guint rows, gdouble elapsed)
+{
+    gint cost_ns, old_cost_ns;
+
+    priv->stats_time += elapsed;
+    if(elapsed > priv->stats_longest_stall)
+        priv->stats_longest_stall = elapsed;
+
+    if(rows == 0)
+        return;
+
+    priv->stats_rows += rows;
+
+    /* Smooth it a bit, contact discovery makes some rows a lot more
+     * expensive than others. */
+    cost_ns = (gint) MIN(elapsed * 1e9 / rows, (gdouble) G_MAXINT);
+    old_cost_ns = g_atomic_int_get(&priv->row_cost_ns);
+    if(old_cost_ns > 0)
+        cost_ns = (old_cost_ns * 3 + cost_ns) / 4;
+    g_atomic_int_set(&priv->row_cost_ns, cost_ns);
+}
+
+static void
+_debug_staging_stats (RTComLogModelPrivate * priv)
+{
+    g_debug("%s: staged %u rows in %.1f ms (%.0f rows/s), "
+            "longest main loop stall %.1f ms", G_STRFUNC,
+            priv->stats_rows, priv->stats_time * 1000,
+            priv->stats_time > 0 ? priv->stats_rows / priv->stats_time : 0,
+            priv->stats_longest_stall * 1000);
+    g_debug("%s: read %u batches in %.1f ms, %u staged after "
+            "%.1f ms in the queue on average, queue depth up to %u/%u",
+            G_STRFUNC, priv->pipe_read_batches, priv->pipe_read_time * 1000,
+            priv->pipe_staged_batches,
+            priv->pipe_staged_batches > 0 ?
+                priv->pipe_wait_time * 1000 / priv->pipe_staged_batches : 0,
+            priv->pipe_max_depth, STAGING_QUEUE_MAX);
+}
+
+/* Stages the whole batch right away, for callers that need the rows in
+ * the model before they return. */
+static void
+_stage_cached_now (caching_data_t * d)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(d->model);
+
+    g_signal_emit(d->model, bulk_insert_begin_signal_id, 0);
+
+    g_timer_start(priv->staging_timer);
+    _stage_cached(d, 0);
+    _record_staging(priv, d->staged,
+            g_timer_elapsed(priv->staging_timer, NULL));
+
+    g_signal_emit(d->model, bulk_insert_end_signal_id, 0);
+
+    _caching_data_free(d);
+}
+
+/* Takes the next batch off the queue, making room for the caching
+ * thread. */
+static caching_data_t *
+_pipe_pop (RTComLogModelPrivate * priv)
+{
+    caching_data_t * d;
+
+    g_mutex_lock(priv->pipe_lock);
+
+    d = g_queue_pop_head(priv->staging_queue);
+    if(d)
+    {
+        priv->pipe_staged_batches++;
+        priv->pipe_wait_time +=
+            g_timer_elapsed(priv->pipe_clock, NULL) - d->queued_at;
+        g_cond_signal(priv->pipe_not_full);
+    }
+
+    g_mutex_unlock(priv->pipe_lock);
+
+    return d;
+}
+
+/* Hands a batch over to the staging source. The caching thread passes
+ * its load and waits while the queue is full, so a slow UI throttles
+ * the reads instead of the whole history piling up in memory. The main
+ * thread passes NULL and must not block: the queue only drains on the
+ * main loop. Returns FALSE, freeing the batch, if the load is stale:
+ * checked with pipe_lock held, so nothing of an abandoned load gets in
+ * after rtcom_log_model_clear() emptied the queue. */
+static gboolean
+_pipe_push (caching_data_t * d, load_t * load)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(d->model);
+    guint depth;
+
+    g_mutex_lock(priv->pipe_lock);
+
+    while(load && !_load_is_stale(priv, load) &&
+          g_queue_get_length(priv->staging_queue) >= STAGING_QUEUE_MAX)
+        g_cond_wait(priv->pipe_not_full, priv->pipe_lock);
+
+    if(load && _load_is_stale(priv, load))
+    {
+        g_mutex_unlock(priv->pipe_lock);
+        _caching_data_free(d);
+        return FALSE;
+    }
+
+    d->queued_at = g_timer_elapsed(priv->pipe_clock, NULL);
+    g_queue_push_tail(priv->staging_queue, d);
+
+    depth = g_queue_get_length(priv->staging_queue);
+    if(depth > priv->pipe_max_depth)
+        priv->pipe_max_depth = depth;
+
+    g_mutex_unlock(priv->pipe_lock);
+
+    g_main_context_wakeup(NULL);
+
+    return TRUE;
+}
+
+static gboolean
+_pipe_is_empty (RTComLogModelPrivate * priv)
+{
+    gboolean empty;
+
+    g_mutex_lock(priv->pipe_lock);
+    empty = g_queue_is_empty(priv->staging_queue);
+    g_mutex_unlock(priv->pipe_lock);
+
+    return empty;
+}
+
+/* Drops the events of the purged services the batch of the load has
+ * left to stage. New events are read after the purge. */
+static void
+_drop_purged_events (load_t * load, caching_data_t * d)
+{
+    RTComLogEventBatch * batch;
+    guint i, kept;
+
+    if(!load || !load->purged_services || !d || d->prepend)
+        return;
+
+    batch = d->batch;
+    for(i = kept = d->staged; i < rtcom_log_event_batch_len(batch); i++)
+    {
+        RTComLogEvent * event = rtcom_log_event_batch_index(batch, i);
+
+        /* Interned, like the service column */
+        if(g_slist_find(load->purged_services, event->service))
+            continue;
+
+        if(kept != i)
+            *rtcom_log_event_batch_index(batch, kept) = *event;
+        kept++;
+    }
+
+    g_array_set_size(batch->events, kept);
+}
+
+/* Stages queued batches for up to one budget. */
+static void
+_stage_pending (RTComLogModel * model)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    guint rows = 0;
+    gdouble budget = STAGING_BUDGET_US / (gdouble) G_USEC_PER_SEC;
+
+    /* Lets the view do its per-row bookkeeping once per slice. */
+    g_signal_emit(model, bulk_insert_begin_signal_id, 0);
+
+    g_timer_start(priv->staging_timer);
+
+    for(;;)
+    {
+        caching_data_t * d = priv->staging_current;
+        guint staged;
+        gboolean done;
+
+        if(!d)
+        {
+            d = priv->staging_current = _pipe_pop(priv);
+            _drop_purged_events(priv->load, d);
+        }
+        if(!d)
+            break;
+
+        staged = d->staged;
+        done = _stage_cached(d, budget);
+
+        rows += d->staged - staged;
+        if(!done)
+            break;
+
+        priv->staging_current = NULL;
+        _caching_data_free(d);
+
+        if(g_timer_elapsed(priv->staging_timer, NULL) >= budget)
+            break;
+    }
+
+    _record_staging(priv, rows, g_timer_elapsed(priv->staging_timer, NULL));
+
+    g_signal_emit(model, bulk_insert_end_signal_id, 0);
+
+    if(!priv->staging_current &&
+       (!priv->load || g_atomic_int_get(&priv->load->finished)) &&
+       _pipe_is_empty(priv))
+    {
+        _debug_staging_stats(priv);
+        if(priv->purge_top_up)
+            _top_up_purged(model);
+    }
+}
+
+static gboolean
+_staging_source_prepare (GSource * source, gint * timeout)
+{
+    RTComLogModelPrivate * priv =
+        RTCOM_LOG_MODEL_GET_PRIV(((staging_source_t *) source)->model);
+
+    *timeout = -1;
+
+    return priv->staging_current != NULL || !_pipe_is_empty(priv);
+}
+
+static gboolean
+_staging_source_check (GSource * source)
+{
+    gint timeout;
+
+    return _staging_source_prepare(source, &timeout);
+}
+
+static gboolean
+_staging_source_dispatch (GSource * source, GSourceFunc callback,
+        gpointer data)
+{
+    _stage_pending(((staging_source_t *) source)->model);
+
+    return TRUE;
+}
+
+static GSourceFuncs staging_source_funcs =
+{
+    _staging_source_prepare,
+    _staging_source_check,
+    _staging_source_dispatch,
+    NULL
+};
+
+/* Queues a batch for staging from the main loop. Main thread only. */
+static void
+_queue_cached (caching_data_t * d)
+{
+    _pipe_push(d, NULL);
+}
+
+/* Drops whatever is waiting to be staged. The load must have been
+ * abandoned already, so its caching thread can't add any more. */
+static void
+_clear_staging_queue (RTComLogModelPrivate * priv)
+{
+    caching_data_t * d;
+
+    while((d = _pipe_pop(priv)) != NULL)
+        _caching_data_free(d);
+
+    _caching_data_free(priv->staging_current);
+    priv->staging_current = NULL;
+}
+
+static gint
+_cached_per_query (RTComLogModelPrivate * priv, gboolean first)
+{
+    gint cost_ns = g_atomic_int_get(&priv->row_cost_ns);
+    gint rows;
+
+    if(cost_ns <= 0)
+        return first ? MAX_CACHED_PER_QUERY_FIRST : MAX_CACHED_PER_QUERY;
+
+    /* The first page is staged synchronously, keep it to about one
+     * budget; later pages feed a few idle dispatches each. */
+    if(first)
+    {
+        rows = (STAGING_BUDGET_US * 1000) / cost_ns;
+        return CLAMP(rows, MAX_CACHED_PER_QUERY_FIRST,
+                3 * MAX_CACHED_PER_QUERY_FIRST);
+    }
+
+    rows = (STAGING_SLICES_PER_QUERY * STAGING_BUDGET_US * 1000) / cost_ns;
+    return CLAMP(rows, MIN_CACHED_PER_QUERY, 5 * MAX_CACHED_PER_QUERY);
+}
+
+/* Reads a page of the current query straight into the batch, when we
+ * have a read func for it. Returns FALSE if the caller has to go through
+ * the event logger. */
+static gboolean
+_read_direct (load_t * load, RTComLogEventBatch * batch,
+        gint before_id, gint limit)
+{
+    if(!load->read_func || !load->query_func ||
+       load->group_by != RTCOM_EL_QUERY_GROUP_BY_NONE)
+        return FALSE;
+
+    if(load->read_func(batch, before_id, limit, load->query_func->data))
+        return TRUE;
+
+    g_warning("%s: couldn't read the events directly, falling back to "
+            "the event logger", G_STRFUNC);
+    return FALSE;
+}
+
+/* Reads up to limit events of an ungrouped load older than before_id,
+ * directly if we can. The load needs a query func. */
+static gboolean
+_read_before (load_t * load, RTComLogEventBatch * batch,
+        gint before_id, gint limit)
+{
+    RTComElQuery * query;
+    RTComElIter * it;
+
+    if(_read_direct(load, batch, before_id, limit))
+        return TRUE;
+
+    query = rtcom_el_query_new(load->backend);
+    rtcom_el_query_set_limit(query, limit);
+    rtcom_el_query_set_offset(query, 0);
+    if(!load->query_func->func(query, before_id, load->query_func->data))
+    {
+        g_warning("Couldn't prepare query");
+        g_object_unref(query);
+        return FALSE;
+    }
+
+    it = rtcom_el_get_events(load->backend, query);
+    if(it && rtcom_el_iter_first(it))
+    {
+        do
+        {
+            rtcom_log_event_batch_append_iter(batch, it);
+        } while(rtcom_el_iter_next(it));
+    }
+    if(it)
+        g_object_unref(it);
+    g_object_unref(query);
+
+    return TRUE;
+}
+
+static void
+_paged_page_free (paged_page_t * page)
+{
+    guint i;
+
+    for(i = 0; i < rtcom_log_event_batch_len(page->batch); i++)
+    {
+        if(page->rows[i].contact)
+            g_object_unref(page->rows[i].contact);
+    }
+
+    g_free(page->rows);
+    rtcom_log_event_batch_free(page->batch);
+    g_slice_free(paged_page_t, page);
+}
+
+static void
+_paged_evict (RTComLogModelPrivate * priv, paged_page_t * page)
+{
+    guint i;
+
+    for(i = 0; i < rtcom_log_event_batch_len(page->batch); i++)
+    {
+        gpointer key = GINT_TO_POINTER(
+                rtcom_log_event_batch_index(page->batch, i)->event_id);
+
+        /* A more recent page may have loaded the same event. */
+        if(g_hash_table_lookup(priv->paged_events, key) == page)
+            g_hash_table_remove(priv->paged_events, key);
+    }
+
+    g_queue_remove(priv->pages, page);
+    g_queue_remove(priv->pages_to_discover, page);
+    _paged_page_free(page);
+}
+
+static void
+_paged_clear (RTComLogModelPrivate * priv)
+{
+    paged_page_t * page;
+
+    while((page = g_queue_pop_head(priv->pages)) != NULL)
+        _paged_page_free(page);
+
+    g_hash_table_remove_all(priv->paged_events);
+    g_queue_clear(priv->pages_to_discover);
+
+    if(priv->paged_discover_id)
+    {
+        g_source_remove(priv->paged_discover_id);
+        priv->paged_discover_id = 0;
+    }
+
+    /* The placeholders go with the pages */
+    if(priv->materialize_id)
+    {
+        g_source_remove(priv->materialize_id);
+        priv->materialize_id = 0;
+    }
+    priv->materialize_before = G_MAXINT;
+}
+
+/* Drops the page holding event_id, so its values get read again. */
+static void
+_paged_forget_event (RTComLogModelPrivate * priv, gint event_id)
+{
+    paged_page_t * page = g_hash_table_lookup(priv->paged_events,
+            GINT_TO_POINTER(event_id));
+
+    if(page)
+        _paged_evict(priv, page);
+}
+
+/* Discovering the contact of a row can take a while, so only do it if
+ * asked to; rows with an abook uid get their contact either way. */
+static void
+_paged_resolve_row (RTComLogModel * model, paged_page_t * page, guint i,
+        gboolean discover)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    RTComLogEvent * event = rtcom_log_event_batch_index(page->batch, i);
+    paged_row_t * row = &page->rows[i];
+
+    row->icon = _lookup_icon(priv, event->icon_name);
+    row->service_icon = _get_service_icon(model, event->local_uid);
+
+    if(row->contact)
+    {
+        g_object_unref(row->contact);
+        row->contact = NULL;
+    }
+
+    if(!priv->abook_aggregator_ready)
+        return;
+
+    /* Same guess as _stage_cached() does */
+    if(discover && !event->remote_ebook_uid && event->local_uid &&
+       event->remote_uid)
+    {
+        gchar * discovered = discover_abook_contact(model,
+                event->local_uid, event->remote_uid);
+
+        event->remote_ebook_uid =
+            rtcom_log_event_batch_strdup(page->batch, discovered);
+        g_free(discovered);
+    }
+
+    row->contact = _get_contact_from_abook_uid(model,
+            event->remote_ebook_uid);
+}
+
+static gboolean
+_paged_discover_idle (gpointer data)
+{
+    RTComLogModel * model = RTCOM_LOG_MODEL(data);
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    GtkTreeModel * tm = GTK_TREE_MODEL(model);
+    paged_page_t * page = g_queue_pop_head(priv->pages_to_discover);
+    guint i;
+
+    /* Otherwise _paged_refresh() does them once the aggregator is */
+    for(i = 0; page && priv->abook_aggregator_ready &&
+        i < rtcom_log_event_batch_len(page->batch); i++)
+    {
+        RTComLogEvent * event = rtcom_log_event_batch_index(page->batch, i);
+        GtkTreeIter iter;
+        GtkTreePath * path;
+
+        if(event->remote_ebook_uid || !event->local_uid || !event->remote_uid)
+            continue;
+
+        _paged_resolve_row(model, page, i, TRUE);
+
+        if(!page->rows[i].contact ||
+           !_lookup_row(model, event->event_id, &iter) ||
+           !_row_is_placeholder(tm, &iter))
+            continue;
+
+        path = gtk_tree_model_get_path(tm, &iter);
+        gtk_tree_model_row_changed(tm, path, &iter);
+        gtk_tree_path_free(path);
+    }
+
+    if(g_queue_is_empty(priv->pages_to_discover))
+    {
+        priv->paged_discover_id = 0;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* Reads up to PAGED_PAGE_SIZE events, starting with start_id and going
+ * back in time, and makes them the most recently used page. Their
+ * contacts are discovered later, from an idle. */
+static paged_page_t *
+_paged_load_page (RTComLogModel * model, gint start_id)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    load_t * load = priv->load;
+    RTComLogEventBatch * batch;
+    paged_page_t * page;
+    gint before_id = start_id < G_MAXINT ? start_id + 1 : start_id;
+    gboolean undiscovered = FALSE;
+    guint i;
+
+    if(!load || !load->query_func)
+        return NULL;
+
+    batch = rtcom_log_event_batch_new(PAGED_PAGE_SIZE);
+
+    if(!_read_before(load, batch, before_id, PAGED_PAGE_SIZE))
+    {
+        rtcom_log_event_batch_free(batch);
+        return NULL;
+    }
+
+    page = g_slice_new0(paged_page_t);
+    page->batch = batch;
+
+    page->rows = g_new0(paged_row_t, rtcom_log_event_batch_len(page->batch));
+    for(i = 0; i < rtcom_log_event_batch_len(page->batch); i++)
+    {
+        RTComLogEvent * event = rtcom_log_event_batch_index(page->batch, i);
+
+        /* Group chat events with a known contact are staged as normal
+         * ones, see _stage_cached(). */
+        if(!priv->show_group_chat && event->remote_ebook_uid)
+            event->flags &= ~RTCOM_EL_FLAG_CHAT_GROUP;
+
+        _paged_resolve_row(model, page, i, FALSE);
+        g_hash_table_insert(priv->paged_events,
+                GINT_TO_POINTER(event->event_id), page);
+
+        if(!event->remote_ebook_uid && event->local_uid && event->remote_uid)
+            undiscovered = TRUE;
+    }
+
+    if(undiscovered && priv->abook_aggregator_ready)
+    {
+        g_queue_push_tail(priv->pages_to_discover, page);
+        if(!priv->paged_discover_id)
+            priv->paged_discover_id = g_idle_add_full(
+                    G_PRIORITY_DEFAULT_IDLE, _paged_discover_idle,
+                    model, NULL);
+    }
+
+    g_queue_push_head(priv->pages, page);
+    while(g_queue_get_length(priv->pages) > PAGED_MAX_PAGES)
+        _paged_evict(priv, g_queue_peek_tail(priv->pages));
+
+    return page;
+}
+
+static gint
+_paged_row_index (paged_page_t * page, gint event_id)
+{
+    guint i;
+
+    for(i = 0; i < rtcom_log_event_batch_len(page->batch); i++)
+    {
+        if(rtcom_log_event_batch_index(page->batch, i)->event_id == event_id)
+            return i;
+    }
+
+    return -1;
+}
+
+static gint
+_row_event_id (GtkTreeModel * tree_model, GtkTreeIter * iter)
+{
+    GValue value = { 0, };
+
+    parent_tree_model_iface->get_value(tree_model, iter,
+            RTCOM_LOG_VIEW_COL_EVENT_ID, &value);
+
+    return g_value_get_int(&value);
+}
+
+static gboolean
+_row_is_placeholder (GtkTreeModel * tree_model, GtkTreeIter * iter)
+{
+    return _row_event_id(tree_model, iter) < 0;
+}
+
+/* Finds the page holding the placeholder row at iter, reading it from
+ * the database if needed. */
+static paged_page_t *
+_paged_lookup (RTComLogModel * model, GtkTreeIter * iter, gint event_id,
+        gint * index)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    paged_page_t * page;
+
+    page = g_hash_table_lookup(priv->paged_events, GINT_TO_POINTER(event_id));
+    if(page)
+    {
+        if(g_queue_peek_head(priv->pages) != page)
+        {
+            g_queue_remove(priv->pages, page);
+            g_queue_push_head(priv->pages, page);
+        }
+    }
+    else
+    {
+        GtkTreePath * path = gtk_tree_model_get_path(GTK_TREE_MODEL(model),
+                iter);
+        gint n = gtk_tree_path_get_indices(path)[0];
+        GtkTreeIter start;
+        gint start_id = event_id;
+
+        gtk_tree_path_free(path);
+
+        /* Load whole aligned pages, so scrolling in either direction
+         * needs one query per PAGED_PAGE_SIZE rows. */
+        if(gtk_tree_model_iter_nth_child(GTK_TREE_MODEL(model), &start,
+                    NULL, n - n % PAGED_PAGE_SIZE))
+            start_id = ABS(_row_event_id(GTK_TREE_MODEL(model), &start));
+
+        page = _paged_load_page(model, start_id);
+
+        /* Rows came or went since the placeholders were staged, just
+         * start from this one. */
+        if(page && _paged_row_index(page, event_id) < 0 &&
+           start_id != event_id)
+            page = _paged_load_page(model, event_id);
+    }
+
+    if(page)
+        *index = _paged_row_index(page, event_id);
+
+    return (page && *index >= 0) ? page : NULL;
+}
+
+static void
+_paged_get_value (RTComLogModel * model, paged_page_t * page, gint i,
+        gint column, GValue * value)
+{
+    RTComLogEvent * event = rtcom_log_event_batch_index(page->batch, i);
+    paged_row_t * row = &page->rows[i];
+
+    switch(column)
+    {
+        case RTCOM_LOG_VIEW_COL_ICON:
+            g_value_set_object(value, row->icon);
+            break;
+        case RTCOM_LOG_VIEW_COL_TEXT:
+            g_value_set_string(value, event->text);
+            break;
+        case RTCOM_LOG_VIEW_COL_CONTACT:
+            g_value_set_object(value, row->contact);
+            break;
+        case RTCOM_LOG_VIEW_COL_SERVICE_ICON:
+            g_value_set_object(value, (gpointer) row->service_icon);
+            break;
+        case RTCOM_LOG_VIEW_COL_LOCAL_ACCOUNT:
+            g_value_set_pointer(value, (gpointer) event->local_uid);
+            break;
+        case RTCOM_LOG_VIEW_COL_REMOTE_ACCOUNT:
+            g_value_set_string(value, event->remote_uid);
+            break;
+        case RTCOM_LOG_VIEW_COL_REMOTE_NAME:
+        {
+            const gchar * name = NULL;
+
+            if(row->contact)
+                name = osso_abook_contact_get_display_name(row->contact);
+            g_value_set_string(value, name ? name : event->remote_name);
+            break;
+        }
+        case RTCOM_LOG_VIEW_COL_ECONTACT_UID:
+            g_value_set_string(value, event->remote_ebook_uid);
+            break;
+        case RTCOM_LOG_VIEW_COL_SERVICE:
+            g_value_set_pointer(value, (gpointer) event->service);
+            break;
+        case RTCOM_LOG_VIEW_COL_GROUP_UID:
+            g_value_set_string(value, event->group_uid);
+            break;
+        case RTCOM_LOG_VIEW_COL_TIMESTAMP:
+            g_value_set_int(value, event->timestamp);
+            break;
+        case RTCOM_LOG_VIEW_COL_END_TIMESTAMP:
+            g_value_set_int(value, event->end_timestamp);
+            break;
+        case RTCOM_LOG_VIEW_COL_COUNT:
+            g_value_set_int(value, event->count);
+            break;
+        case RTCOM_LOG_VIEW_COL_GROUP_TITLE:
+            g_value_set_string(value, event->group_title);
+            break;
+        case RTCOM_LOG_VIEW_COL_EVENT_TYPE:
+            g_value_set_pointer(value, (gpointer) event->event_type);
+            break;
+        case RTCOM_LOG_VIEW_COL_OUTGOING:
+            g_value_set_boolean(value, event->outgoing);
+            break;
+        case RTCOM_LOG_VIEW_COL_FLAGS:
+            g_value_set_int(value, event->flags);
+            break;
+        default:
+            break;
+    }
+}
+
+/* Re-resolves the icons and contacts of the pages in memory, and tells
+ * the view about the rows that may look different now. */
+static void
+_paged_refresh (RTComLogModel * model)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    GtkTreeModel * tm = GTK_TREE_MODEL(model);
+    GList * l;
+    GtkTreeIter iter;
+    gboolean valid;
+
+    if(g_queue_is_empty(priv->pages))
+        return;
+
+    for(l = priv->pages->head; l; l = l->next)
+    {
+        paged_page_t * page = l->data;
+        guint i;
+
+        for(i = 0; i < rtcom_log_event_batch_len(page->batch); i++)
+            _paged_resolve_row(model, page, i, TRUE);
+    }
+
+    valid = gtk_tree_model_get_iter_first(tm, &iter);
+    while(valid)
+    {
+        gint event_id = _row_event_id(tm, &iter);
+
+        if(event_id < 0 && g_hash_table_lookup(priv->paged_events,
+                    GINT_TO_POINTER(-event_id)))
+        {
+            GtkTreePath * path = gtk_tree_model_get_path(tm, &iter);
+
+            gtk_tree_model_row_changed(tm, path, &iter);
+            gtk_tree_path_free(path);
+        }
+
+        valid = gtk_tree_model_iter_next(tm, &iter);
+    }
+}
+
+/* Reads the value as the store keeps it, see _column_is_interned() */
+static void
+_get_stored_value (
+        GtkTreeModel * tree_model,
+        GtkTreeIter * iter,
+        gint column,
+        GValue * value)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(tree_model);
+    gint event_id = _row_event_id(tree_model, iter);
+    paged_page_t * page;
+    gint i;
+
+    if(event_id >= 0)
+    {
+        parent_tree_model_iface->get_value(tree_model, iter, column, value);
+        return;
+    }
+
+    event_id = -event_id;
+    g_value_init(value,
+            parent_tree_model_iface->get_column_type(tree_model, column));
+
+    if(column == RTCOM_LOG_VIEW_COL_EVENT_ID)
+    {
+        g_value_set_int(value, event_id);
+        return;
+    }
+
+    /* Whole-model scans for a contact, or by a search, shouldn't pull
+     * the entire history in a page at a time; rows that aren't in
+     * memory aren't being shown either. A search gets them as full
+     * rows from the materialize idle instead. */
+    if(column == RTCOM_LOG_VIEW_COL_CONTACT || priv->searching)
+    {
+        page = g_hash_table_lookup(priv->paged_events,
+                GINT_TO_POINTER(event_id));
+        i = page ? _paged_row_index(page, event_id) : -1;
+        if(i >= 0)
+            _paged_get_value(RTCOM_LOG_MODEL(tree_model), page, i, column,
+                    value);
+        return;
+    }
+
+    page = _paged_lookup(RTCOM_LOG_MODEL(tree_model), iter, event_id, &i);
+    if(page)
+        _paged_get_value(RTCOM_LOG_MODEL(tree_model), page, i, column, value);
+}
+
+static GType
+rtcom_log_model_get_column_type (
+        GtkTreeModel * tree_model,
+        gint column)
+{
+    if(_column_is_interned(column))
+        return G_TYPE_STRING;
+
+    return parent_tree_model_iface->get_column_type(tree_model, column);
+}
+
+static void
+rtcom_log_model_get_value (
+        GtkTreeModel * tree_model,
+        GtkTreeIter * iter,
+        gint column,
+        GValue * value)
+{
+    GValue stored = { 0 };
+
+    if(!_column_is_interned(column))
+    {
+        _get_stored_value(tree_model, iter, column, value);
+        return;
+    }
+
+    /* Interned strings live as long as the program, so the value
+     * doesn't need a copy of its own. */
+    _get_stored_value(tree_model, iter, column, &stored);
+    g_value_init(value, G_TYPE_STRING);
+    g_value_set_static_string(value, g_value_get_pointer(&stored));
+    g_value_unset(&stored);
+}
+
+static void
+rtcom_log_model_tree_model_init(
+        GtkTreeModelIface * iface)
+{
+    parent_tree_model_iface = g_type_interface_peek_parent(iface);
+
+    iface->get_column_type = rtcom_log_model_get_column_type;
+    iface->get_value = rtcom_log_model_get_value;
+}
+
+/* Reads the next page of the load through the event logger. Returns
+ * FALSE if it couldn't, or if the load went stale meanwhile. */
+static gboolean
+_load_read_query (RTComLogModelPrivate * priv, load_t * load,
+        RTComLogEventBatch * batch, gint limit)
+{
+    RTComElQuery * query;
+    RTComElIter * it = NULL;
+    gboolean ok = TRUE;
+
+    if(load->query_func)
+    {
+        /* Grouped queries aggregate over the whole history, so an id
+         * bound would change the groups themselves: page those by
+         * offset. The query is our own, load->query goes on to the next
+         * populate on a refresh while we may still be running. */
+        gboolean seek = load->group_by == RTCOM_EL_QUERY_GROUP_BY_NONE;
+
+        query = rtcom_el_query_new(load->backend);
+        rtcom_el_query_set_group_by(query, load->group_by);
+        rtcom_el_query_set_limit(query, limit);
+        rtcom_el_query_set_offset(query,
+                seek ? 0 : g_atomic_int_get(&load->cached_n));
+        if(!load->query_func->func(query, seek ? load->seek_id : G_MAXINT,
+                    load->query_func->data))
+        {
+            g_warning("Couldn't prepare query");
+            g_object_unref(query);
+            return FALSE;
+        }
+    }
+    else
+    {
+        query = g_object_ref(load->query);
+        rtcom_el_query_set_limit(query, limit);
+        rtcom_el_query_set_offset(query,
+                g_atomic_int_get(&load->cached_n));
+
+        if(!rtcom_el_query_refresh(query))
+        {
+            g_object_unref(query);
+            return FALSE;
+        }
+    }
+
+    it = rtcom_el_get_events(load->backend, query);
+    if(it && rtcom_el_iter_first(it))
+    {
+        do
+        {
+            if(_load_is_stale(priv, load))
+            {
+                ok = FALSE;
+                break;
+            }
+
+            rtcom_log_event_batch_append_iter(batch, it);
+        } while(rtcom_el_iter_next(it));
+    }
+    if(it)
+        g_object_unref(it);
+    g_object_unref(query);
+
+    return ok;
+}
+
+static gpointer
+_threaded_cached_load (gpointer data)
+{
+    load_t * load = data;
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(load->model);
+
+    for(;;)
+    {
+        caching_data_t * d;
+        gint limit;
+        gdouble read_start;
+
+        if(_load_is_stale(priv, load))
+            break;
+
+        /* Placeholders are cheap to stage, fetch them in bigger pages */
+        if (load->paged)
+            limit = PAGED_SCAN_PER_QUERY;
+        else
+            limit = _cached_per_query(priv, FALSE);
+        if (load->limit != -1)
+          {
+            gint cached_n = g_atomic_int_get(&load->cached_n);
 
-    GtkIconTheme * icon_theme;
-    icon_theme = gtk_icon_theme_get_default();
+            /* Cache up to specified limit */
+            if ((cached_n + limit) > load->limit)
+                limit = load->limit - cached_n;
 
-    model = caching_data->model;
-    priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+            if (limit < 1)
+                break;
+          }
+        d = _caching_data_new(load->model, FALSE, limit);
+        d->placeholders = load->paged;
 
-    for(    caching_data->cached_events = g_list_first(caching_data->cached_events),
-            events_iter = caching_data->cached_events;
-            events_iter;
-            events_iter = events_iter->next)
-    {
-        GdkPixbuf * icon = NULL;
-        const GdkPixbuf * service_icon;
+        read_start = g_timer_elapsed(priv->pipe_clock, NULL);
 
-        memset(&staging_data, 0, sizeof(struct _staging_data));
+        if(!_read_direct(load, d->batch, load->seek_id, limit) &&
+           !_load_read_query(priv, load, d->batch, limit))
+        {
+            _caching_data_free(d);
+            break;
+        }
 
-        if(priv->cancel_threads)
+        if(rtcom_log_event_batch_len(d->batch) == 0)
         {
-            g_list_foreach(
-                    caching_data->cached_events,
-                    (GFunc) g_hash_table_destroy,
-                    NULL);
-            g_list_free(caching_data->cached_events);
-            g_free(caching_data);
-            return FALSE;
+            _caching_data_free(d);
+            break;
         }
 
-        staging_data.values = (GHashTable *) events_iter->data;
-
-#define LOOKUP_INT(x) \
-    g_value_get_int(g_hash_table_lookup(staging_data.values, x))
-#define LOOKUP_BOOL(x) \
-    g_value_get_boolean(g_hash_table_lookup(staging_data.values, x))
-#define LOOKUP_STR(x) \
-    g_value_get_string(g_hash_table_lookup(staging_data.values, x))
-
-        staging_data.event_id = LOOKUP_INT ("id");
-        staging_data.service = LOOKUP_STR ("service");
-        staging_data.group_uid = LOOKUP_STR ("group-uid");
-        staging_data.local_uid = LOOKUP_STR ("local-uid");
-        staging_data.remote_uid = LOOKUP_STR ("remote-uid");
-        staging_data.remote_name = LOOKUP_STR ("remote-name");
-        staging_data.remote_ebook_uid = LOOKUP_STR ("remote-ebook-uid");
-        staging_data.text = LOOKUP_STR ("content");
-        staging_data.icon_name = LOOKUP_STR ("icon-name");
-        staging_data.timestamp = LOOKUP_INT ("start-time");
-        staging_data.end_timestamp = LOOKUP_INT("end-time");
-        staging_data.count = LOOKUP_INT ("event-count");
-        staging_data.group_title = LOOKUP_STR ("group-title");
-        staging_data.event_type = LOOKUP_STR ("event-type");
-        staging_data.outgoing = LOOKUP_BOOL ("outgoing");
-        staging_data.flags = LOOKUP_INT ("flags");
-
-        /* if requested, ignore groupchat events */
-        if (!priv->show_group_chat &&
-            (staging_data.flags & RTCOM_EL_FLAG_CHAT_GROUP) &&
-            !strcmp (staging_data.service, "RTCOM_EL_SERVICE_CHAT"))
-        {
-            /* this is ugly; some protocols use normal remote uids of contacts
-             * even for groupchat messages (notably, skype); if we ignore
-             * those and grouping is by uids or contact, we won't show *any*
-             * messages (incl. non-groupchat-ones) from that contact, because
-             * the database gave us only this row; in this
-             * case it's prefferable that we treat the groupchat message as
-             * a normal one; so, if abook euid of the contact is known, we'll
-             * treat the message as a normal one instead. otherwise, we ignore
-             * it. */
-            if (staging_data.remote_ebook_uid)
-              {
-                staging_data.flags &= ~RTCOM_EL_FLAG_CHAT_GROUP;
-              }
-            else
-              {
-                g_hash_table_destroy(staging_data.values);
-                continue;
-              }
+        g_atomic_int_add(&load->cached_n,
+                rtcom_log_event_batch_len(d->batch));
+        load->seek_id = rtcom_log_event_batch_index(d->batch,
+                rtcom_log_event_batch_len(d->batch) - 1)->event_id;
+
+        _decode_batch(load, d->batch);
+
+        g_mutex_lock(priv->pipe_lock);
+        if(!_load_is_stale(priv, load))
+        {
+            priv->pipe_read_batches++;
+            priv->pipe_read_time +=
+                g_timer_elapsed(priv->pipe_clock, NULL) - read_start;
         }
+        g_mutex_unlock(priv->pipe_lock);
 
-        g_debug("Staging event:\n\tid: %d\n\tservice: %s\n\tgroup_uid: %s\n\tlocal_uid: %s\n\tremote_uid: %s\n\t"
-                "remote_name: %s\n\tremote_ebook_uid: %s\n\ttext: %s\n\ticon_name: %s\n\t"
-                "timestamp: %d\n\tend_timestamp: %d\n\tevents in group: %d\n\tgroup title: %s\n\tevent type: %s\n\t"
-                "outgoing: %s\n\t flags: %d\n",
-                staging_data.event_id,
-                staging_data.service,
-                staging_data.group_uid,
-                staging_data.local_uid,
-                staging_data.remote_uid,
-                staging_data.remote_name,
-                staging_data.remote_ebook_uid,
-                staging_data.text,
-                staging_data.icon_name,
-                staging_data.timestamp,
-                staging_data.end_timestamp,
-                staging_data.count,
-                staging_data.group_title,
-                staging_data.event_type,
-                staging_data.outgoing ? "yes" : "no",
-                staging_data.flags);
-
-        if(staging_data.icon_name)
-        {
-            icon = g_hash_table_lookup(
-                    priv->cached_icons,
-                    staging_data.icon_name);
-            if(!icon)
+        if(!_pipe_push(d, load))
+            break;
+    }
+
+    g_atomic_int_set(&load->finished, TRUE);
+
+    return NULL;
+}
+
+
+/* Adds what the contact's uids may be: the keys of its phone numbers in
+ * the index and the values of the vcard fields of the accounts. */
+static void
+_collect_contact_keys (RTComLogModelPrivate * priv,
+        OssoABookContact * contact, GHashTable * keys)
+{
+    GList * attrs;
+
+    rtcom_log_phone_index_contact_keys (priv->phone_index,
+        e_contact_get_const (E_CONTACT (contact), E_CONTACT_UID), keys);
+
+    for (attrs = e_vcard_get_attributes (E_VCARD (contact)); attrs;
+         attrs = attrs->next)
+    {
+        const gchar * name = e_vcard_attribute_get_name (attrs->data);
+        GHashTableIter fields;
+        gpointer field;
+
+        if (!strcmp (name, EVC_TEL))
+            continue;
+
+        g_hash_table_iter_init (&fields, priv->vcard_field_mapping);
+        while (g_hash_table_iter_next (&fields, NULL, &field))
+        {
+            if (!strcmp (name, field))
             {
-                icon = gtk_icon_theme_load_icon(
-                        gtk_icon_theme_get_default(),
-                        staging_data.icon_name,
-                        RTCOM_LOG_VIEW_ICON_SIZE,
-                        0, NULL);
-                if(icon)
-                    g_hash_table_insert(
-                            priv->cached_icons,
-                            g_strdup(staging_data.icon_name),
-                            icon);
+                gchar * value = e_vcard_attribute_get_value (attrs->data);
+
+                if (value)
+                    g_hash_table_replace (keys, value, value);
+                break;
             }
         }
+    }
+}
 
-        service_icon = _get_service_icon (model, staging_data.local_uid);
+static gboolean
+_remote_uid_has_key (GHashTable * keys, const gchar * remote_uid)
+{
+    gchar * key;
+    gboolean found;
 
-        gtk_list_store_insert_with_values(
-                GTK_LIST_STORE(model),
-                &iter,
-                caching_data->prepend ? 0 : GTK_LIST_STORE(model)->length,
-
-                RTCOM_LOG_VIEW_COL_ICON,           icon,
-                RTCOM_LOG_VIEW_COL_EVENT_ID,       staging_data.event_id,
-                RTCOM_LOG_VIEW_COL_SERVICE,        staging_data.service,
-                RTCOM_LOG_VIEW_COL_GROUP_UID,      staging_data.group_uid,
-
-                RTCOM_LOG_VIEW_COL_LOCAL_ACCOUNT,  staging_data.local_uid,
-                RTCOM_LOG_VIEW_COL_REMOTE_ACCOUNT, staging_data.remote_uid,
-                RTCOM_LOG_VIEW_COL_REMOTE_NAME,    staging_data.remote_name,
-                RTCOM_LOG_VIEW_COL_ECONTACT_UID,   staging_data.remote_ebook_uid,
-
-                RTCOM_LOG_VIEW_COL_TEXT,           staging_data.text,
-                RTCOM_LOG_VIEW_COL_TIMESTAMP,      staging_data.timestamp,
-                RTCOM_LOG_VIEW_COL_END_TIMESTAMP,   staging_data.end_timestamp,
-                RTCOM_LOG_VIEW_COL_COUNT,          staging_data.count,
-                RTCOM_LOG_VIEW_COL_GROUP_TITLE,    staging_data.group_title,
-                RTCOM_LOG_VIEW_COL_EVENT_TYPE,     staging_data.event_type,
-                RTCOM_LOG_VIEW_COL_OUTGOING,       staging_data.outgoing,
-                RTCOM_LOG_VIEW_COL_FLAGS,          staging_data.flags,
-
-                /* We shouldn't be setting NULL for a GObject and we don't
-                 * want to use separate set (to minimise row redraw), so we're
-                 * tricking GtkListStore into thinking that's the terminator.
-                 */
-                (service_icon != NULL) ? RTCOM_LOG_VIEW_COL_SERVICE_ICON : -1,
-                    service_icon,
+    if (g_hash_table_lookup (keys, remote_uid))
+        return TRUE;
 
-                -1);
+    key = rtcom_log_phone_index_number_key (remote_uid);
+    found = key && g_hash_table_lookup (keys, key);
+    g_free (key);
 
-        if(priv->abook_aggregator_ready)
-        {
-            OssoABookContact *c;
+    return found;
+}
 
-            /* Attempt to guess remote_ebook_uid if possible */
-            if (!staging_data.remote_ebook_uid &&
-                staging_data.local_uid &&
-                staging_data.remote_uid)
-            {
-                staging_data.remote_ebook_uid = discover_abook_contact (model,
-                    staging_data.local_uid,
-                    staging_data.remote_uid);
-
-                /* We want to put the discovered uid back to the staging data
-                 * values so it gets freed afterwards, with the rest of them. */
-                g_value_take_string (g_hash_table_lookup (staging_data.values,
-                    "remote-ebook-uid"), (gchar *) staging_data.remote_ebook_uid);
-            }
+/* Has discovery try the remote uids the changed contacts may have
+ * again, and the rows with them looked up again. */
+static void
+_rediscover_keys (RTComLogModel * model, GHashTable * keys)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    GHashTableIter hash_iter;
+    GSList * rows = NULL, * l;
+    gpointer row, remote_uid;
+    GtkTreeIter iter;
 
-            c = _get_contact_from_abook_uid (model,
-                staging_data.remote_ebook_uid);
-
-            /* If we find the contact, store it and its display name
-             * immediately, and call populate pixbufs on it.
-             *
-             * TODO: remove duplicate code from here and
-             * _remote_contact_discovery (here we need to discover a
-             * single one, while _remote_contact_discovery does it
-             * for all undiscovered contacts in the list store. */
-            if (c)
-            {
-                const gchar *name = osso_abook_contact_get_display_name (c);
+    if (g_hash_table_size (keys) == 0)
+        return;
 
-                gtk_list_store_set (GTK_LIST_STORE(model), &iter,
-                    RTCOM_LOG_VIEW_COL_CONTACT, c,
-                    RTCOM_LOG_VIEW_COL_ECONTACT_UID,
-                        staging_data.remote_ebook_uid,
-                    -1);
+    g_hash_table_iter_init (&hash_iter, priv->unknown_contacts);
+    while (g_hash_table_iter_next (&hash_iter, NULL, &remote_uid))
+    {
+        if (_remote_uid_has_key (keys, remote_uid))
+            g_hash_table_iter_remove (&hash_iter);
+    }
+
+    g_hash_table_iter_init (&hash_iter, priv->unresolved_rows);
+    while (g_hash_table_iter_next (&hash_iter, &row, &remote_uid))
+    {
+        if (_remote_uid_has_key (keys, remote_uid))
+            rows = g_slist_prepend (rows, row);
+    }
 
-                if (name)
-                    gtk_list_store_set (GTK_LIST_STORE (model),
-                        &iter, RTCOM_LOG_VIEW_COL_REMOTE_NAME,
-                        name, -1);
+    iter.stamp = GTK_LIST_STORE(model)->stamp;
+    for (l = rows; l; l = l->next)
+    {
+        iter.user_data = l->data;
+        _queue_resolve (model, &iter);
+    }
+    g_slist_free (rows);
+}
 
-                staging_data.account_data = _populate_pixbufs(
-                        model,
-                        staging_data.local_uid,
-                        staging_data.remote_uid,
-                        c);
+static void
+_contacts_changed_callback (
+        OssoABookRoster * roster,
+        OssoABookContact ** contacts,
+        RTComLogModel * model)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    GHashTable * keys = NULL;
 
-                g_object_unref (c);
-            }
-        }
-        else
-        {
-            g_debug(G_STRLOC ": couldn't find contact because the aggregator is not ready.");
-            priv->pixbufs_populated = FALSE;
-        }
+    /* Until the index is built, discovery hasn't run */
+    if (priv->phone_index)
+        keys = g_hash_table_new_full (g_str_hash, g_str_equal,
+            g_free, NULL);
 
-        if (staging_data.account_data && staging_data.account_data->contact)
-          {
-            const gchar *name =
-                osso_abook_contact_get_display_name
-                    (staging_data.account_data->contact);
+    for (; contacts && *contacts; contacts++)
+    {
+        const gchar * uid = e_contact_get_const (E_CONTACT (*contacts),
+            E_CONTACT_UID);
 
-            if (name != NULL)
-              gtk_list_store_set (GTK_LIST_STORE (model), &iter,
-                  RTCOM_LOG_VIEW_COL_REMOTE_NAME, name, -1);
-          }
+        if (uid)
+            g_hash_table_replace (priv->stale_contacts, g_strdup (uid),
+                GINT_TO_POINTER (TRUE));
 
-        /**
-         * Now let's figure out if this new event that we just added,
-         * belongs to an existing group. Of course this can only be if
-         * we're adding a single new event, so that caching_data->prepend
-         * will be TRUE.
-         * If this is the case, we just need to delete the old row
-         * representing the group.
-         */
-        if(priv->group_by == RTCOM_EL_QUERY_GROUP_BY_GROUP)
+        if (keys)
         {
-            deletion_iter = iter;
-            while(gtk_tree_model_iter_next(GTK_TREE_MODEL(model), &deletion_iter))
-            {
-                deletion_group_uid = NULL;
-                gtk_tree_model_get(
-                        GTK_TREE_MODEL(model),
-                        &deletion_iter,
-                        RTCOM_LOG_VIEW_COL_GROUP_UID, &deletion_group_uid,
-                        -1);
-                if(staging_data.group_uid && deletion_group_uid &&
-                   !strcmp(deletion_group_uid, staging_data.group_uid))
-                {
-                    g_debug(G_STRLOC ": we found the old group, let's delete it.");
-                    gtk_list_store_remove(GTK_LIST_STORE(model), &deletion_iter);
-                    g_free (deletion_group_uid);
-                    break;
-                }
-                g_free (deletion_group_uid);
-            }
+            /* The numbers it had may now be another contact's alone */
+            rtcom_log_phone_index_contact_keys (priv->phone_index, uid,
+                keys);
+            rtcom_log_phone_index_add_contact (priv->phone_index,
+                *contacts);
+            _collect_contact_keys (priv, *contacts, keys);
         }
-        else if(priv->group_by == RTCOM_EL_QUERY_GROUP_BY_UIDS)
-        {
-            deletion_iter = iter;
-            while(gtk_tree_model_iter_next(GTK_TREE_MODEL(model), &deletion_iter))
-            {
-                gtk_tree_model_get(
-                        GTK_TREE_MODEL(model),
-                        &deletion_iter,
-                        RTCOM_LOG_VIEW_COL_LOCAL_ACCOUNT, &deletion_local_uid,
-                        RTCOM_LOG_VIEW_COL_REMOTE_ACCOUNT, &deletion_remote_uid,
-                        -1);
-                if(staging_data.local_uid && staging_data.remote_uid &&
-                   deletion_local_uid && deletion_remote_uid)
-                {
-                    if(strcmp(deletion_local_uid, staging_data.local_uid) == 0 &&
-                       strcmp(deletion_remote_uid, staging_data.remote_uid) == 0)
-                    {
-                        g_debug(G_STRLOC ": we found the old entry for this contacts pair, let's delete it.");
-                        gtk_list_store_remove(GTK_LIST_STORE(model), &deletion_iter);
-                        g_free(deletion_local_uid);
-                        g_free(deletion_remote_uid);
-                        break;
-                    }
-                }
+    }
 
-                g_free(deletion_local_uid);
-                g_free(deletion_remote_uid);
-            }
-        }
-        else if(priv->group_by == RTCOM_EL_QUERY_GROUP_BY_CONTACT)
-        {
-            GtkTreeIter moving_iter;
+    if (keys)
+    {
+        _rediscover_keys (model, keys);
+        g_hash_table_destroy (keys);
+    }
+}
 
-            deletion_iter = iter;
-            while(gtk_tree_model_iter_next(GTK_TREE_MODEL(model), &deletion_iter))
-            {
-                deletion_ebook_uid = NULL;
-                gtk_tree_model_get(
-                        GTK_TREE_MODEL(model),
-                        &deletion_iter,
-                        RTCOM_LOG_VIEW_COL_LOCAL_ACCOUNT, &deletion_local_uid,
-                        RTCOM_LOG_VIEW_COL_REMOTE_ACCOUNT, &deletion_remote_uid,
-                        RTCOM_LOG_VIEW_COL_ECONTACT_UID, &deletion_ebook_uid,
-                        -1);
-                if(deletion_ebook_uid && staging_data.remote_ebook_uid &&
-                  !strcmp(deletion_ebook_uid, staging_data.remote_ebook_uid))
-                {
-                    g_debug(G_STRLOC ": we found the old entry for this contact, let's delete it.");
-                    gtk_list_store_remove(GTK_LIST_STORE(model), &deletion_iter);
-                    g_free (deletion_ebook_uid);
-                    g_free(deletion_local_uid);
-                    g_free(deletion_remote_uid);
-                    break;
-                }
-                else if(staging_data.local_uid && staging_data.remote_uid &&
-                   deletion_local_uid && deletion_remote_uid &&
-                  (strcmp(deletion_local_uid, staging_data.local_uid) == 0 &&
-                     strcmp(deletion_remote_uid, staging_data.remote_uid) == 0))
-                {
-                    g_debug(G_STRLOC ": we found the old entry for this contacts pair, let's delete it.");
-                    gtk_list_store_remove(GTK_LIST_STORE(model), &deletion_iter);
-                    g_free (deletion_ebook_uid);
-                    g_free(deletion_local_uid);
-                    g_free(deletion_remote_uid);
-                    break;
-                }
-                else
-                {
-                    g_debug(G_STRLOC ": couldn't match the EBook UIDs nor the (local,remote) UID pair.");
-                    g_debug(G_STRLOC ": deletion_ebook_uid = %s, staging_data.remote_ebook_uid = %s",
-                            deletion_ebook_uid, staging_data.remote_ebook_uid);
-                    g_free (deletion_ebook_uid);
-                    g_free(deletion_local_uid);
-                    g_free(deletion_remote_uid);
-                }
-            }
+static void
+_contacts_added_callback (
+        OssoABookRoster * roster,
+        OssoABookContact ** contacts,
+        RTComLogModel * model)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    GHashTable * keys;
 
-            /**
-             * Now let's get back at the inserted iter and figure out if we
-             * need to move it down.
-             */
-            moving_iter = iter;
-            while(gtk_tree_model_iter_next(GTK_TREE_MODEL(model), &moving_iter))
-            {
-                gint id_moving_iter;
-
-                gtk_tree_model_get(
-                        GTK_TREE_MODEL(model), &moving_iter,
-                        RTCOM_LOG_VIEW_COL_EVENT_ID, &id_moving_iter,
-                        -1);
-                g_debug(G_STRLOC ": iterating moving_iter with id %d", id_moving_iter);
-                if(id_moving_iter > staging_data.event_id)
-                {
-                    /**
-                     * Found it!
-                     */
-                    g_debug(G_STRLOC ": move it down!");
-                    gtk_list_store_swap(
-                            GTK_LIST_STORE(model),
-                            &moving_iter,
-                            &iter);
-                }
-                else
-                    break;
-            }
-        }
+    /* The aggregator adds its contacts while it loads, before the
+     * index gets built from all of them */
+    if (!priv->phone_index)
+        return;
+
+    keys = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+    for (; contacts && *contacts; contacts++)
+    {
+        rtcom_log_phone_index_add_contact (priv->phone_index, *contacts);
+        _collect_contact_keys (priv, *contacts, keys);
+    }
+
+    _rediscover_keys (model, keys);
+    g_hash_table_destroy (keys);
+}
+
+static void
+_contacts_removed_callback (
+        OssoABookRoster * roster,
+        const gchar ** uids,
+        RTComLogModel * model)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    GHashTable * keys = NULL;
+
+    if (priv->phone_index)
+        keys = g_hash_table_new_full (g_str_hash, g_str_equal,
+            g_free, NULL);
+
+    for (; uids && *uids; uids++)
+    {
+        g_hash_table_replace (priv->stale_contacts, g_strdup (*uids),
+            GINT_TO_POINTER (TRUE));
 
-        /* If we ended up with more events than we should show, trim the last
-         * ones (index starts at 0). */
-        if (priv->limit != -1)
+        /* A number it shared with another contact is that one's now */
+        if (keys)
         {
-            while (gtk_tree_model_iter_nth_child(GTK_TREE_MODEL(model),
-                &deletion_iter, NULL, priv->limit))
-            {
-                gtk_list_store_remove(GTK_LIST_STORE(model), &deletion_iter);
-            }
+            rtcom_log_phone_index_contact_keys (priv->phone_index, *uids,
+                keys);
+            rtcom_log_phone_index_remove_contact (priv->phone_index, *uids);
         }
+    }
 
-        g_hash_table_destroy(staging_data.values);
+    if (keys)
+    {
+        _rediscover_keys (model, keys);
+        g_hash_table_destroy (keys);
     }
+}
+
+static void
+_connect_aggregator_signals (RTComLogModel *model)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
 
-    g_list_free(caching_data->cached_events);
-    g_free(caching_data);
+    priv->aggregator_ready_closure =
+        osso_abook_waitable_call_when_ready (OSSO_ABOOK_WAITABLE(priv->abook_aggregator),
+            _abook_aggregator_ready, model, NULL);
 
-    return FALSE;
+    /* Keep the phone index and the unknown contacts current */
+    priv->contacts_added_handler = g_signal_connect (
+            priv->abook_aggregator, "contacts-added",
+            G_CALLBACK (_contacts_added_callback), model);
+
+    /* Tells refresh hints caused by contact edits which contacts to
+     * resolve again, and the phone index what to index again. */
+    priv->contacts_changed_handler = g_signal_connect (
+            priv->abook_aggregator, "contacts-changed",
+            G_CALLBACK (_contacts_changed_callback), model);
+    priv->contacts_removed_handler = g_signal_connect (
+            priv->abook_aggregator, "contacts-removed",
+            G_CALLBACK (_contacts_removed_callback), model);
 }
 
-static gpointer
-_threaded_cached_load (gpointer data)
+static void
+_create_own_aggregator(
+        RTComLogModel * model)
 {
-    RTComLogModel * model = RTCOM_LOG_MODEL(data);
-    RTComLogModelPrivate * priv = NULL;
-    RTComElIter * it = NULL;
-    GHashTable * values = NULL;
+    GList * distinct_remote_uids;
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
 
-    g_return_val_if_fail(RTCOM_IS_LOG_MODEL(model), FALSE);
+    priv->own_aggregator = TRUE;
 
-    priv = RTCOM_LOG_MODEL_GET_PRIV(model);
-    g_return_val_if_fail(RTCOM_IS_EL(priv->backend), FALSE);
-    g_return_val_if_fail(RTCOM_IS_EL_QUERY(priv->current_query), FALSE);
+    distinct_remote_uids = rtcom_el_get_unique_remote_ebook_uids(
+            priv->backend);
+    if(distinct_remote_uids && g_list_length(distinct_remote_uids) > 0)
+    {
+        GList * iter;
+
+        priv->abook_aggregator = OSSO_ABOOK_AGGREGATOR(
+                osso_abook_aggregator_new(NULL, NULL));
+        priv->abook_aggregator_ready = FALSE;
+        _connect_aggregator_signals(model);
+
+        priv->abook_subs = osso_abook_contact_subscriptions_new();
+        for(iter = distinct_remote_uids; iter; iter = iter->next)
+        {
+            osso_abook_contact_subscriptions_add(
+                    priv->abook_subs,
+                    iter->data);
+            g_free(iter->data);
+        }
 
-    if(priv->done_caching)
+        g_list_free(distinct_remote_uids);
+
+        osso_abook_aggregator_add_filter(
+                OSSO_ABOOK_AGGREGATOR(priv->abook_aggregator),
+                OSSO_ABOOK_CONTACT_FILTER(priv->abook_subs));
+
+        osso_abook_roster_start(OSSO_ABOOK_ROSTER(priv->abook_aggregator));
+    }
+    else
     {
-        g_debug("All events cached!");
-        return NULL;
+        g_debug("Not creating the aggregator because there are no events"
+                " in the db with a remote_ebook_uid.");
     }
+}
 
-    for(;;)
-    {
-        gint limit;
 
-        if(priv->cancel_threads)
-            return NULL;
+static gint
+_compare_event_ids (gconstpointer a, gconstpointer b)
+{
+    return ((const RTComLogEvent *) a)->event_id -
+        ((const RTComLogEvent *) b)->event_id;
+}
 
-        limit = MAX_CACHED_PER_QUERY;
-        if (priv->limit != -1)
-          {
-            /* Cache up to specified limit */
-            if ((priv->cached_n + limit) > priv->limit)
-                limit = priv->limit - priv->cached_n;
+static gint
+_compare_ints (gconstpointer a, gconstpointer b)
+{
+    return *(const gint *) a - *(const gint *) b;
+}
 
-            /* If priv->limit changed in the meantime, this can happen.
-             * Don't do anything else. */
-            if (limit < 1)
-              {
-                priv->done_caching = TRUE;
-                break;
-              }
-          }
-        rtcom_el_query_set_limit(priv->current_query, limit);
-        rtcom_el_query_set_offset(priv->current_query, priv->cached_n);
-        if(!rtcom_el_query_refresh(priv->current_query))
-        {
-            g_object_unref(priv->current_query);
-            priv->current_query = NULL;
-            return NULL;
-        }
+static void
+_drop_new_events (RTComLogModelPrivate * priv)
+{
+    if (priv->new_events_id)
+    {
+        g_source_remove (priv->new_events_id);
+        priv->new_events_id = 0;
+    }
 
-        it = rtcom_el_get_events(priv->backend, priv->current_query);
-        if(it && rtcom_el_iter_first(it))
-        {
-            caching_data_t * d = g_new0(caching_data_t, 1);
-            d->model = model;
-            d->prepend = FALSE;
+    g_array_set_size (priv->new_event_ids, 0);
+}
 
-            do
-            {
-                if(priv->cancel_threads)
-                {
-                    g_object_unref(it);
-                    g_list_free(d->cached_events);
-                    g_free(d);
-                    return NULL;
-                }
+/* Reads the events with the given ids, ungrouped, into the batch. */
+static void
+_read_new_events (RTComLogModelPrivate * priv, const gint * ids, guint n_ids,
+        RTComLogEventBatch * batch)
+{
+    RTComElQuery * query;
+    RTComElIter * el_iter;
+    gchar ** strv;
+    guint i;
 
-                values = rtcom_el_iter_get_value_map(
-                        it,
-                        "id",
-                        "service",
-                        "group-uid",
-                        "local-uid",
-                        "remote-uid",
-                        "remote-name",
-                        "remote-ebook-uid",
-                        "content",
-                        "icon-name",
-                        "start-time",
-                        "end-time",
-                        "event-count",
-                        "group-title",
-                        "event-type",
-                        "outgoing",
-                        "flags",
-                        NULL);
-                d->cached_events = g_list_prepend(d->cached_events, values);
-            } while(rtcom_el_iter_next(it));
+    /* The event logger can't OR conditions, but matches a column
+     * against a list of strings, which SQLite compares as integers for
+     * the id column. */
+    strv = g_new0(gchar *, n_ids + 1);
+    for(i = 0; i < n_ids; i++)
+        strv[i] = g_strdup_printf("%d", ids[i]);
 
-            g_object_unref(it);
+    query = rtcom_el_query_new(priv->backend);
+    rtcom_el_query_set_group_by(query, RTCOM_EL_QUERY_GROUP_BY_NONE);
+    if(!rtcom_el_query_prepare(
+                query,
+                "id", strv, RTCOM_EL_OP_IN_STRV,
+                NULL))
+    {
+        g_warning("Couldn't prepare query");
+        g_object_unref(query);
+        g_strfreev(strv);
+        return;
+    }
 
-            priv->cached_n += MAX_CACHED_PER_QUERY;
+    el_iter = rtcom_el_get_events(priv->backend, query);
+    g_object_unref(query);
+    g_strfreev(strv);
 
-            d->cached_events = g_list_reverse(d->cached_events);
-            g_idle_add((GSourceFunc) _stage_cached, d);
-        }
-        else
+    if(el_iter && rtcom_el_iter_first(el_iter))
+    {
+        do
         {
-            priv->done_caching = TRUE;
-            break;
-        }
+            rtcom_log_event_batch_append_iter(batch, el_iter);
+        } while(rtcom_el_iter_next(el_iter));
     }
 
-    return NULL;
+    if(el_iter)
+        g_object_unref(el_iter);
 }
 
-
+/* Reads the new events through the read func of the list, if it has
+ * one: being the newest, they're in the page ending with the newest of
+ * them, along with older ones we drop. The ids it doesn't have, like
+ * those of the events the query leaves out, stay in ids. */
 static void
-_connect_aggregator_signals (RTComLogModel *model)
+_read_new_events_direct (RTComLogModelPrivate * priv, GArray * ids,
+        RTComLogEventBatch * batch)
 {
-    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    load_t * load = priv->load;
+    gboolean * found;
+    guint i, kept, missing;
 
-    priv->aggregator_ready_closure =
-        osso_abook_waitable_call_when_ready (OSSO_ABOOK_WAITABLE(priv->abook_aggregator),
-            _abook_aggregator_ready, model, NULL);
+    if(!load || ids->len == 0)
+        return;
+
+    g_array_sort(ids, _compare_ints);
+
+    kept = rtcom_log_event_batch_len(batch);
+    if(!_read_direct(load, batch, g_array_index(ids, gint, ids->len - 1) + 1,
+                ids->len))
+        return;
+
+    found = g_new0(gboolean, ids->len);
+    for(i = kept; i < rtcom_log_event_batch_len(batch); i++)
+    {
+        RTComLogEvent * event = rtcom_log_event_batch_index(batch, i);
+        gint * id = bsearch(&event->event_id, ids->data, ids->len,
+                sizeof(gint), _compare_ints);
+
+        if(!id)
+            continue;
+
+        found[id - (gint *) ids->data] = TRUE;
+        if(kept != i)
+            *rtcom_log_event_batch_index(batch, kept) = *event;
+        kept++;
+    }
+    g_array_set_size(batch->events, kept);
+
+    for(i = missing = 0; i < ids->len; i++)
+    {
+        if(!found[i])
+            g_array_index(ids, gint, missing++) = g_array_index(ids, gint, i);
+    }
+    g_array_set_size(ids, missing);
+
+    g_free(found);
 }
 
+/* Reads the pending new events, a chunk of ids per query, and stages
+ * them oldest first so the newest ends up on top. The events are read
+ * one by one rather than grouped, so a burst of events of the same
+ * group replaces the group's row once per event, as single new events
+ * do. */
 static void
-_create_own_aggregator(
-        RTComLogModel * model)
+_stage_new_events (RTComLogModel * model)
 {
-    GList * distinct_remote_uids;
     RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    GArray * ids = priv->new_event_ids;
+    caching_data_t * d;
+    guint i, n;
 
-    priv->own_aggregator = TRUE;
-
-    distinct_remote_uids = rtcom_el_get_unique_remote_ebook_uids(
-            priv->backend);
-    if(distinct_remote_uids && g_list_length(distinct_remote_uids) > 0)
+    if (priv->new_events_id)
     {
-        GList * iter;
+        g_source_remove (priv->new_events_id);
+        priv->new_events_id = 0;
+    }
 
-        priv->abook_aggregator = OSSO_ABOOK_AGGREGATOR(
-                osso_abook_aggregator_new(NULL, NULL));
-        priv->abook_aggregator_ready = FALSE;
-        priv->pixbufs_populated = FALSE;
-        _connect_aggregator_signals(model);
+    if (ids->len == 0)
+        return;
 
-        priv->abook_subs = osso_abook_contact_subscriptions_new();
-        for(iter = distinct_remote_uids; iter; iter = iter->next)
-        {
-            osso_abook_contact_subscriptions_add(
-                    priv->abook_subs,
-                    iter->data);
-            g_free(iter->data);
-        }
+    d = _caching_data_new(model, TRUE, ids->len);
 
-        g_list_free(distinct_remote_uids);
+    _read_new_events_direct(priv, ids, d->batch);
+    for(i = 0; i < ids->len; i += NEW_EVENTS_PER_QUERY)
+        _read_new_events(priv, &g_array_index(ids, gint, i),
+                MIN(NEW_EVENTS_PER_QUERY, ids->len - i), d->batch);
 
-        osso_abook_aggregator_add_filter(
-                OSSO_ABOOK_AGGREGATOR(priv->abook_aggregator),
-                OSSO_ABOOK_CONTACT_FILTER(priv->abook_subs));
+    g_array_set_size (ids, 0);
 
-        osso_abook_roster_start(OSSO_ABOOK_ROSTER(priv->abook_aggregator));
+    n = rtcom_log_event_batch_len(d->batch);
+    if(n == 0)
+    {
+        _caching_data_free(d);
+        return;
     }
-    else
+
+    /* Each prepended row goes on top of the previous one. */
+    g_array_sort(d->batch->events, _compare_event_ids);
+
+    for(i = 0; i < n; i++)
     {
-        g_debug("Not creating the aggregator because there are no events"
-                " in the db with a remote_ebook_uid.");
+        RTComLogEvent * event = rtcom_log_event_batch_index(d->batch, i);
+
+        if(event->remote_ebook_uid)
+        {
+            g_debug("The new event has a remote_ebook_uid (%s): creating the "
+                    "aggregator if we don't have it already",
+                    event->remote_ebook_uid);
+            if(priv->abook_aggregator == NULL && priv->create_aggregator)
+            {
+                _create_own_aggregator(model);
+            }
+            break;
+        }
     }
+
+    _stage_cached_now (d);
 }
 
+static gboolean
+_new_events_timeout_cb (gpointer model)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+
+    priv->new_events_id = 0;
+    _stage_new_events (model);
+
+    return FALSE;
+}
 
 static void
 _new_event_callback (
@@ -1343,9 +3619,6 @@ _new_event_callback (
         RTComLogModel * model)
 {
     RTComLogModelPrivate * priv = NULL;
-    RTComElQuery * query = NULL;
-    RTComElIter * el_iter = NULL;
-    GHashTable * values = NULL;
 
     g_return_if_fail(RTCOM_IS_LOG_MODEL(model));
 
@@ -1377,73 +3650,14 @@ _new_event_callback (
             return;
     }
 
-    query = rtcom_el_query_new(priv->backend);
-    rtcom_el_query_set_group_by(query, priv->group_by);
-    if(!rtcom_el_query_prepare(
-                query,
-                "id", event_id, RTCOM_EL_OP_EQUAL,
-                NULL))
-    {
-        g_warning("Couldn't prepare query");
-        g_object_unref(query);
-        return;
-    }
-
-    el_iter = rtcom_el_get_events(priv->backend, query);
-    g_object_unref(query);
-
-    if(el_iter && rtcom_el_iter_first(el_iter))
-    {
-        values = rtcom_el_iter_get_value_map(
-                el_iter,
-                "id",
-                "service",
-                "group-uid",
-                "local-uid",
-                "remote-uid",
-                "remote-name",
-                "remote-ebook-uid",
-                "content",
-                "icon-name",
-                "start-time",
-                "end-time",
-                "event-count",
-                "group-title",
-                "event-type",
-                "outgoing",
-                "flags",
-                NULL);
-        g_object_unref(el_iter);
-    }
-
-    if(values)
-    {
-        caching_data_t * d = NULL;
-        const gchar * remote_ebook_uid;
-        remote_ebook_uid = g_value_get_string(g_hash_table_lookup(values,
-              "remote-ebook-uid"));
-        if(remote_ebook_uid)
-        {
-            g_debug("The new event has a remote_ebook_uid (%s): creating the "
-                    "aggregator if we don't have it already", remote_ebook_uid);
-            if(priv->abook_aggregator == NULL && priv->create_aggregator)
-            {
-                _create_own_aggregator(model);
-            }
-        }
-
-        d = g_new0(caching_data_t, 1);
-        d->model = model;
-        d->prepend = TRUE;
-        d->cached_events = g_list_prepend(d->cached_events, values);
-
-        priv->cached_n += MAX_CACHED_PER_QUERY;
-
-        /* We do it immediately instead of the idle loop so
-         * if event gets updated, the update won't come before
-         * the event is added. */
-        _stage_cached (d);
-    }
+    /* New events are collected for a while and read with one query, so
+     * that bursts of them (an import, a sync) don't cost a query each.
+     * Updates and deletions stage the pending
+     * ones first, so they never come before the event is added. */
+    g_array_append_val(priv->new_event_ids, event_id);
+    if(priv->new_events_id == 0)
+        priv->new_events_id = g_timeout_add(NEW_EVENTS_DELAY_MS,
+                _new_events_timeout_cb, model);
 }
 
 static gboolean
@@ -1457,60 +3671,19 @@ _find_event (
     GtkTreeIter *retval,
     gint *event_id_retval)
 {
-    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
-    GtkTreeIter iter;
-    gboolean found = FALSE;
-
-    if (!gtk_tree_model_iter_children(GTK_TREE_MODEL(model), &iter, NULL))
-        return FALSE;
-
-    do
+    if(_lookup_row(model, event_id, retval))
     {
-        gint id_iter = -1;
-        gchar *local_uid_iter = NULL;
-        gchar *remote_uid_iter = NULL;
-        gchar *group_uid_iter = NULL;
-        gchar *remote_ebook_uid_iter = NULL;
-
-        gtk_tree_model_get(
-                GTK_TREE_MODEL(model), &iter,
-                RTCOM_LOG_VIEW_COL_EVENT_ID, &id_iter,
-                RTCOM_LOG_VIEW_COL_LOCAL_ACCOUNT, &local_uid_iter,
-                RTCOM_LOG_VIEW_COL_REMOTE_ACCOUNT, &remote_uid_iter,
-                RTCOM_LOG_VIEW_COL_ECONTACT_UID, &remote_ebook_uid_iter,
-                RTCOM_LOG_VIEW_COL_GROUP_UID, &group_uid_iter,
-                -1);
-
-        g_debug ("[iterator: id %d, local %s, remote %s, group %s, ebook_uid %s]",
-            id_iter, local_uid_iter, remote_uid_iter, group_uid_iter, remote_ebook_uid_iter);
-
-        if(
-          (id_iter == event_id) ||
-
-          ((priv->group_by == RTCOM_EL_QUERY_GROUP_BY_GROUP) &&
-           (group_uid_iter && group_uid &&
-            !strcmp(group_uid_iter, group_uid))) ||
-
-          ((priv->group_by == RTCOM_EL_QUERY_GROUP_BY_CONTACT) &&
-           (remote_ebook_uid_iter && remote_ebook_uid &&
-            strcmp(remote_ebook_uid_iter, remote_ebook_uid) == 0)) ||
-
-          ((priv->group_by == RTCOM_EL_QUERY_GROUP_BY_UIDS) &&
-           (local_uid_iter && local_uid && strcmp(local_uid_iter, local_uid) == 0) &&
-           (remote_uid_iter && remote_uid && strcmp(remote_uid_iter, remote_uid) == 0)))
-        {
-            found = TRUE;
-            *retval = iter;
-            *event_id_retval = id_iter;
-        }
+        *event_id_retval = event_id;
+        return TRUE;
+    }
 
-        g_free (local_uid_iter);
-        g_free (remote_uid_iter);
-        g_free (group_uid_iter);
-        g_free (remote_ebook_uid_iter);
-    } while (!found && gtk_tree_model_iter_next(GTK_TREE_MODEL(model), &iter));
+    /* Then, when grouping, by the row standing for its group */
+    if(!_lookup_group(model, local_uid, remote_uid, remote_ebook_uid,
+                group_uid, retval))
+        return FALSE;
 
-    return found;
+    *event_id_retval = _row_event_id(GTK_TREE_MODEL(model), retval);
+    return TRUE;
 }
 
 
@@ -1541,12 +3714,19 @@ _event_updated_callback (
     if (!priv->in_use)
         return;
 
+    _stage_new_events (model);
+
     if (!_find_event(model, event_id, local_uid, remote_uid, remote_ebook_uid,
         group_uid, &iter, &id_iter))
       return;
 
     g_debug(G_STRLOC ": row found. Need to update icon and text.");
 
+    /* Lazily loaded rows are read from the database again; the
+     * row-changed from gtk_list_store_set() below redraws them. */
+    if (_row_is_placeholder (GTK_TREE_MODEL(model), &iter))
+        _paged_forget_event (priv, id_iter);
+
     query = rtcom_el_query_new(backend);
     /**
      * Setting the grouping property of the query is necessary
@@ -1631,6 +3811,130 @@ _event_updated_callback (
     g_object_unref(query);
 }
 
+/* Makes the row stand for event, the next most recent of its group. */
+static void
+_replace_group_row (RTComLogModel * model, GtkTreeIter * iter,
+        RTComLogEvent * event, gint count)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+
+    _unindex_row(model, iter);
+    _unindex_group(model, iter);
+
+    gtk_list_store_set(
+            GTK_LIST_STORE(model), iter,
+            RTCOM_LOG_VIEW_COL_EVENT_ID, event->event_id,
+            RTCOM_LOG_VIEW_COL_ICON, _lookup_icon(priv, event->icon_name),
+            RTCOM_LOG_VIEW_COL_SERVICE, event->service,
+            RTCOM_LOG_VIEW_COL_SERVICE_ICON,
+                _get_service_icon(model, event->local_uid),
+            RTCOM_LOG_VIEW_COL_LOCAL_ACCOUNT, event->local_uid,
+            RTCOM_LOG_VIEW_COL_REMOTE_ACCOUNT, event->remote_uid,
+            RTCOM_LOG_VIEW_COL_TEXT, event->text,
+            RTCOM_LOG_VIEW_COL_TIMESTAMP, event->timestamp,
+            RTCOM_LOG_VIEW_COL_END_TIMESTAMP, event->end_timestamp,
+            RTCOM_LOG_VIEW_COL_COUNT, count,
+            RTCOM_LOG_VIEW_COL_GROUP_TITLE, event->group_title,
+            RTCOM_LOG_VIEW_COL_EVENT_TYPE, event->event_type,
+            RTCOM_LOG_VIEW_COL_OUTGOING, event->outgoing,
+            RTCOM_LOG_VIEW_COL_FLAGS, event->flags,
+            -1);
+
+    _index_row(priv, iter, event->event_id);
+    _index_group(model, iter);
+
+    _move_to_sorted(model, iter, event->event_id);
+}
+
+/* Handles the deletion of an event of the group of the row from what
+ * the model knows of the group, reading at most the event replacing
+ * it. Returns FALSE, leaving the row alone, if it doesn't know enough
+ * and the database has to be asked. */
+static gboolean
+_delete_from_group (RTComLogModel * model, GtkTreeIter * iter,
+        gint event_id, gint id_iter)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    group_stats_t * stats = g_hash_table_lookup(priv->group_stats,
+            iter->user_data);
+    RTComLogEventBatch * batch;
+    RTComElQuery * query;
+    RTComElIter * el_iter;
+    gboolean found = FALSE;
+    guint i;
+
+    if(!stats || stats->count < 1)
+        return FALSE;
+
+    if(stats->count == 1)
+    {
+        g_debug(G_STRLOC ": that was the last event of the group.");
+        _remove_row(model, iter);
+        return TRUE;
+    }
+
+    if(id_iter != event_id)
+    {
+        /* The row stays as it is, but for the count */
+        for(i = 0; i < stats->n_recent; i++)
+        {
+            if(stats->recent[i] == event_id)
+            {
+                stats->n_recent--;
+                g_memmove(stats->recent + i, stats->recent + i + 1,
+                        (stats->n_recent - i) * sizeof(gint));
+                break;
+            }
+        }
+
+        stats->count--;
+        gtk_list_store_set(GTK_LIST_STORE(model), iter,
+                RTCOM_LOG_VIEW_COL_COUNT, stats->count,
+                -1);
+        return TRUE;
+    }
+
+    /* The row's own event went, the next one takes over */
+    if(stats->n_recent < 2)
+        return FALSE;
+
+    query = rtcom_el_query_new(priv->backend);
+    rtcom_el_query_set_group_by(query, priv->group_by);
+    if(!rtcom_el_query_prepare(
+                query,
+                "id", stats->recent[1], RTCOM_EL_OP_EQUAL,
+                NULL))
+    {
+        g_warning("Couldn't prepare query");
+        g_object_unref(query);
+        return FALSE;
+    }
+
+    el_iter = rtcom_el_get_events(priv->backend, query);
+    g_object_unref(query);
+
+    batch = rtcom_log_event_batch_new(1);
+    if(el_iter && rtcom_el_iter_first(el_iter))
+        found = rtcom_log_event_batch_append_iter(batch, el_iter);
+    if(el_iter)
+        g_object_unref(el_iter);
+
+    if(found)
+    {
+        stats->n_recent--;
+        g_memmove(stats->recent, stats->recent + 1,
+                stats->n_recent * sizeof(gint));
+        stats->count--;
+
+        _replace_group_row(model, iter,
+                rtcom_log_event_batch_index(batch, 0), stats->count);
+    }
+
+    rtcom_log_event_batch_free(batch);
+
+    return found;
+}
+
 static void
 _event_deleted_callback (
         RTComEl * backend,
@@ -1659,6 +3963,8 @@ _event_deleted_callback (
     if (!priv->in_use)
         return;
 
+    _stage_new_events (model);
+
     if (!_find_event(model, event_id, local_uid, remote_uid, remote_ebook_uid,
         group_uid, &iter, &id_iter))
       return;
@@ -1671,7 +3977,7 @@ _event_deleted_callback (
              * the row and forget about it! :)
              */
             g_debug(G_STRLOC ": row found. Need to delete it.");
-            gtk_list_store_remove(GTK_LIST_STORE(model), &iter);
+            _remove_row(model, &iter);
             break;
 
         case RTCOM_EL_QUERY_GROUP_BY_UIDS:
@@ -1689,7 +3995,12 @@ _event_deleted_callback (
              * case we need to redraw the row and possibly move it down.
              */
 
-            gint number_of_events = rtcom_el_get_local_remote_uid_events_n(
+            gint number_of_events;
+
+            if(_delete_from_group(model, &iter, event_id, id_iter))
+                break;
+
+            number_of_events = rtcom_el_get_local_remote_uid_events_n(
                     backend, local_uid, remote_uid);
 
             g_debug("%s: the pair of local_ui=%s and remote_uid=%s "
@@ -1703,7 +4014,7 @@ _event_deleted_callback (
                  * remove the row and forget about it.
                  */
 
-                gtk_list_store_remove(GTK_LIST_STORE(model), &iter);
+                _remove_row(model, &iter);
             }
             else
             {
@@ -1723,9 +4034,8 @@ _event_deleted_callback (
 
                 RTComElQuery   * query;
                 RTComElIter    * el_iter;
-                GHashTable    * values;
 
-                gtk_list_store_remove(GTK_LIST_STORE(model), &iter);
+                _remove_row(model, &iter);
 
                 query = rtcom_el_query_new(backend);
                 rtcom_el_query_set_group_by(query, priv->group_by);
@@ -1744,38 +4054,13 @@ _event_deleted_callback (
                 if(el_iter && rtcom_el_iter_first(el_iter))
                 {
                     caching_data_t * d;
-                    RTComLogModelPrivate * priv;
-
-                    values = rtcom_el_iter_get_value_map(
-                            el_iter,
-                            "id",
-                            "service",
-                            "group-uid",
-                            "local-uid",
-                            "remote-uid",
-                            "remote-name",
-                            "remote-ebook-uid",
-                            "content",
-                            "icon-name",
-                            "start-time",
-                            "end-time",
-                            "event-count",
-                            "group-title",
-                            "event-type",
-                            "outgoing",
-                            "flags",
-                            NULL);
-
-                    d = g_new0(caching_data_t, 1);
-                    d->model = model;
-                    d->prepend = TRUE;
-                    d->cached_events = g_list_prepend(d->cached_events, values);
-
-                    priv = RTCOM_LOG_MODEL_GET_PRIV(model);
-                    priv->done_caching = TRUE;
-                    priv->cached_n += MAX_CACHED_PER_QUERY;
-
-                    g_idle_add((GSourceFunc) _stage_cached, d);
+
+                    d = _caching_data_new(model, TRUE, 1);
+                    rtcom_log_event_batch_append_iter(d->batch, el_iter);
+
+                    d->replaces = TRUE;
+
+                    _queue_cached(d);
                 }
 
                 if(query)
@@ -1806,7 +4091,12 @@ _event_deleted_callback (
              * row and possibly move it down.
              */
 
-            gint number_of_events = rtcom_el_get_contacts_events_n(
+            gint number_of_events;
+
+            if(_delete_from_group(model, &iter, event_id, id_iter))
+                break;
+
+            number_of_events = rtcom_el_get_contacts_events_n(
                     backend,
                     remote_ebook_uid);
 
@@ -1822,7 +4112,7 @@ _event_deleted_callback (
                  * forget about it.
                  */
 
-                gtk_list_store_remove(GTK_LIST_STORE(model), &iter);
+                _remove_row(model, &iter);
             }
             else
             {
@@ -1842,9 +4132,8 @@ _event_deleted_callback (
 
                 RTComElQuery   * query;
                 RTComElIter    * el_iter;
-                GHashTable    * values;
 
-                gtk_list_store_remove(GTK_LIST_STORE(model), &iter);
+                _remove_row(model, &iter);
 
                 query = rtcom_el_query_new(backend);
                 rtcom_el_query_set_group_by(query, priv->group_by);
@@ -1862,38 +4151,13 @@ _event_deleted_callback (
                 if(el_iter && rtcom_el_iter_first(el_iter))
                 {
                     caching_data_t * d;
-                    RTComLogModelPrivate * priv;
-
-                    values = rtcom_el_iter_get_value_map(
-                            el_iter,
-                            "id",
-                            "service",
-                            "group-uid",
-                            "local-uid",
-                            "remote-uid",
-                            "remote-name",
-                            "remote-ebook-uid",
-                            "content",
-                            "icon-name",
-                            "start-time",
-                            "end-time",
-                            "event-count",
-                            "group-title",
-                            "event-type",
-                            "outgoing",
-                            "flags",
-                            NULL);
-
-                    d = g_new0(caching_data_t, 1);
-                    d->model = model;
-                    d->prepend = TRUE;
-                    d->cached_events = g_list_prepend(d->cached_events, values);
-
-                    priv = RTCOM_LOG_MODEL_GET_PRIV(model);
-                    priv->done_caching = TRUE;
-                    priv->cached_n += MAX_CACHED_PER_QUERY;
-
-                    g_idle_add((GSourceFunc) _stage_cached, d);
+
+                    d = _caching_data_new(model, TRUE, 1);
+                    rtcom_log_event_batch_append_iter(d->batch, el_iter);
+
+                    d->replaces = TRUE;
+
+                    _queue_cached(d);
                 }
 
                 if(query)
@@ -2005,7 +4269,7 @@ _event_deleted_callback (
             if(el_iter && rtcom_el_iter_first(el_iter))
             {
                 gboolean outgoing;
-                const gchar *event_type;
+                gchar *event_type;
                 gint flags;
 
                 /**
@@ -2027,8 +4291,6 @@ _event_deleted_callback (
                         "flags", &flags,
                         NULL))
                 {
-                    GtkTreeIter resort_iter;
-
                     g_debug("Got id=%d, icon_name=\"%s\", text=\"%s\", "
                             "remote_name = \"%s\" and event_type = \"%s\".",
                             new_id, icon_name, text, remote_name, event_type);
@@ -2052,6 +4314,7 @@ _event_deleted_callback (
                         }
                     }
 
+                    _unindex_row(model, &iter);
                     gtk_list_store_set(
                             GTK_LIST_STORE(model),
                             &iter,
@@ -2059,63 +4322,127 @@ _event_deleted_callback (
                             RTCOM_LOG_VIEW_COL_ICON, icon,
                             RTCOM_LOG_VIEW_COL_TEXT, text,
                             RTCOM_LOG_VIEW_COL_REMOTE_NAME, remote_name,
-                            RTCOM_LOG_VIEW_COL_EVENT_TYPE, event_type,
+                            RTCOM_LOG_VIEW_COL_EVENT_TYPE,
+                                g_intern_string(event_type),
                             RTCOM_LOG_VIEW_COL_OUTGOING, outgoing,
                             RTCOM_LOG_VIEW_COL_FLAGS, flags,
                             -1);
+                    _index_row(priv, &iter, new_id);
 
                     /**
                      * Alright, we updated the row, now it's time to see if
-                     * we have to move it down.
+                     * we have to move it down, past the rows more recent
+                     * than it now.
                      */
-                    resort_iter = iter;
-                    while(gtk_tree_model_iter_next(GTK_TREE_MODEL(model), &resort_iter))
-                    {
-                        gint id_resort_iter = -1;
-
-                        gtk_tree_model_get(
-                                GTK_TREE_MODEL(model), &resort_iter,
-                                RTCOM_LOG_VIEW_COL_EVENT_ID, &id_resort_iter,
-                                -1);
-                        g_debug(G_STRLOC ": iterating resort_iter with id %d", id_resort_iter);
-                        if(id_resort_iter > new_id)
-                        {
-                            /**
-                             * Found it!
-                             */
-                            g_debug(G_STRLOC ": move it down!");
-                            gtk_list_store_swap(
-                                    GTK_LIST_STORE(model),
-                                    &resort_iter,
-                                    &iter);
-                        }
-                        else
-                            break;
-                    }
+                    _move_to_sorted(model, &iter, new_id);
+
+                    g_free (icon_name);
+                    g_free (text);
+                    g_free (remote_name);
+                    g_free (event_type);
+                }
+
+           }
+            else
+            {
+                /**
+                 * If we're here it means that the query didn't return any
+                 * results, i.e. there's no more events in that group. So
+                 * we can just delete the row!
+                 */
+                _remove_row(model, &iter);
+            }
+
+            if(query)
+                g_object_unref(query);
+            if(el_iter)
+                g_object_unref(el_iter);
+
+            break;
+        }
+    }
+}
+
+/* Removes the rows of the service from an ungrouped list, reading older
+ * events to fill a limited one up again. Grouped rows may stand for
+ * events of several services and lazily loaded ones don't know theirs,
+ * so those lists return FALSE, untouched, to be refreshed instead. */
+static gboolean
+_purge_service (RTComLogModel * model, const gchar * service)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    GtkTreeModel * tm = GTK_TREE_MODEL(model);
+    load_t * load = priv->load;
+    GtkTreeIter iter;
+    gboolean valid;
+
+    if(priv->paged || priv->group_by != RTCOM_EL_QUERY_GROUP_BY_NONE)
+        return FALSE;
+
+    /* Topping up pages by id */
+    if(priv->limit != -1 && !(load && load->query_func))
+        return FALSE;
+
+    /* The column is interned, so this is a pointer comparison */
+    service = g_intern_string(service);
+
+    valid = gtk_tree_model_get_iter_first(tm, &iter);
+    while(valid)
+    {
+        if(_row_interned(model, &iter, RTCOM_LOG_VIEW_COL_SERVICE) ==
+                service)
+            valid = _remove_row(model, &iter);
+        else
+            valid = gtk_tree_model_iter_next(tm, &iter);
+    }
+
+    /* What the load read before the events got deleted may still have
+     * some of them, and reads the ones older than the rows we'd top up
+     * from. */
+    if(load && (!g_atomic_int_get(&load->finished) ||
+                priv->staging_current || !_pipe_is_empty(priv)))
+    {
+        load->purged_services = g_slist_prepend(load->purged_services,
+                (gpointer) service);
+        _drop_purged_events(load, priv->staging_current);
+        priv->purge_top_up = priv->limit != -1;
+        return TRUE;
+    }
 
-                    g_free (icon_name);
-                    g_free (text);
-                    g_free (remote_name);
-                }
+    _top_up_purged(model);
 
-           }
-            else
-            {
-                /**
-                 * If we're here it means that the query didn't return any
-                 * results, i.e. there's no more events in that group. So
-                 * we can just delete the row!
-                 */
-                gtk_list_store_remove(GTK_LIST_STORE(model), &iter);
-            }
+    return TRUE;
+}
 
-            if(query)
-                g_object_unref(query);
-            if(el_iter)
-                g_object_unref(el_iter);
+/* Fills a limited list the purge left short with older events. */
+static void
+_top_up_purged (RTComLogModel * model)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    GtkTreeModel * tm = GTK_TREE_MODEL(model);
+    load_t * load = priv->load;
+    GtkTreeIter iter;
+    gint room;
 
-            break;
+    priv->purge_top_up = FALSE;
+
+    room = priv->limit - (gint) GTK_LIST_STORE(model)->length;
+    if(priv->limit != -1 && room > 0 && load && load->query_func &&
+       !priv->paged && priv->group_by == RTCOM_EL_QUERY_GROUP_BY_NONE)
+    {
+        caching_data_t * d = _caching_data_new(model, FALSE, room);
+        gint before_id = G_MAXINT;
+
+        if(_last_row(model, &iter))
+            before_id = _row_event_id(tm, &iter);
+
+        if(_read_before(load, d->batch, before_id, room))
+        {
+            _decode_batch(load, d->batch);
+            _stage_cached_now(d);
         }
+        else
+            _caching_data_free(d);
     }
 }
 
@@ -2133,7 +4460,8 @@ _all_deleted_callback(
     {
         /* All the events in the database have been deleted, so we can
          * safely empty the model, whatever service it was filtering. */
-        gtk_list_store_clear(GTK_LIST_STORE(model));
+        _drop_new_events(RTCOM_LOG_MODEL_GET_PRIV(model));
+        _clear_rows(model);
         return;
     }
 
@@ -2141,7 +4469,8 @@ _all_deleted_callback(
     if(priv->filtered_services == NULL)
     {
         /* We're showing all the events, so we gotta refresh */
-        rtcom_log_model_refresh(model);
+        if(!_purge_service(model, service))
+            rtcom_log_model_refresh(model);
         return;
     }
 
@@ -2150,20 +4479,197 @@ _all_deleted_callback(
         if(strcmp(service, priv->filtered_services[i]) == 0)
         {
             /* We are displaying events from that service, let's refresh */
-            rtcom_log_model_refresh(model);
+            if(!_purge_service(model, service))
+                rtcom_log_model_refresh(model);
             break;
         }
     }
 }
 
+static gboolean
+_contact_is_stale (RTComLogModelPrivate * priv, OssoABookContact * contact)
+{
+    const gchar * uid;
+
+    if (!contact)
+        return FALSE;
+
+    uid = e_contact_get_const (E_CONTACT (contact), E_CONTACT_UID);
+    return uid && g_hash_table_lookup (priv->stale_contacts, uid);
+}
+
+static gboolean
+_account_data_is_stale (gpointer key, gpointer value, gpointer priv)
+{
+    account_data_t * account_data = value;
+
+    return _contact_is_stale (priv, account_data->contact);
+}
+
+/* Has the rows of the contacts gone show what their events have again,
+ * reading the events a chunk of ids per query. */
+static void
+_revert_rows_to_events (RTComLogModel * model, GArray * rows)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    GtkTreeModel * tm = GTK_TREE_MODEL(model);
+    RTComLogEventBatch * batch;
+    GHashTable * names;
+    GArray * ids;
+    GtkTreeIter iter;
+    guint i;
+
+    ids = g_array_sized_new (FALSE, FALSE, sizeof (gint), rows->len);
+    iter.stamp = GTK_LIST_STORE(model)->stamp;
+    for (i = 0; i < rows->len; i++)
+    {
+        gint event_id;
+
+        iter.user_data = g_array_index (rows, gpointer, i);
+        event_id = _row_event_id (tm, &iter);
+        g_array_append_val (ids, event_id);
+    }
+
+    batch = rtcom_log_event_batch_new (ids->len);
+    for (i = 0; i < ids->len; i += NEW_EVENTS_PER_QUERY)
+        _read_new_events (priv, &g_array_index (ids, gint, i),
+            MIN (NEW_EVENTS_PER_QUERY, ids->len - i), batch);
+
+    /* The names stay in the batch */
+    names = g_hash_table_new (g_direct_hash, g_direct_equal);
+    for (i = 0; i < rtcom_log_event_batch_len (batch); i++)
+    {
+        RTComLogEvent * event = rtcom_log_event_batch_index (batch, i);
+
+        g_hash_table_insert (names, GINT_TO_POINTER (event->event_id),
+            (gpointer) event->remote_name);
+    }
+
+    for (i = 0; i < rows->len; i++)
+    {
+        const gchar * local_uid;
+        gchar * remote_uid = NULL;
+
+        iter.user_data = g_array_index (rows, gpointer, i);
+        local_uid = _row_interned (model, &iter,
+            RTCOM_LOG_VIEW_COL_LOCAL_ACCOUNT);
+        gtk_tree_model_get (tm, &iter,
+            RTCOM_LOG_VIEW_COL_REMOTE_ACCOUNT, &remote_uid,
+            -1);
+
+        /* The row goes back to the group of its uids too */
+        _unindex_group (model, &iter);
+        gtk_list_store_set (GTK_LIST_STORE (model), &iter,
+            RTCOM_LOG_VIEW_COL_CONTACT, NULL,
+            RTCOM_LOG_VIEW_COL_ECONTACT_UID, NULL,
+            RTCOM_LOG_VIEW_COL_REMOTE_NAME,
+                g_hash_table_lookup (names, GINT_TO_POINTER (
+                    g_array_index (ids, gint, i))),
+            -1);
+        _index_group (model, &iter);
+
+        /* Another contact may have the number */
+        if (local_uid && remote_uid)
+            _queue_resolve (model, &iter);
+
+        g_free (remote_uid);
+    }
+
+    g_hash_table_destroy (names);
+    rtcom_log_event_batch_free (batch);
+    g_array_free (ids, TRUE);
+}
+
+/* Drops the cached account data of the contacts changed or removed
+ * since the last time, and resolves the rows showing them again. */
+static void
+_evict_stale_contacts (RTComLogModel * model)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    GtkTreeModel * tm = GTK_TREE_MODEL(model);
+    GArray * gone;
+    GtkTreeIter iter;
+    gboolean valid;
+
+    if (g_hash_table_size (priv->stale_contacts) == 0)
+        return;
+
+    g_hash_table_foreach_remove (priv->cached_account_data,
+        _account_data_is_stale, priv);
+
+    gone = g_array_new (FALSE, FALSE, sizeof (gpointer));
+
+    valid = gtk_tree_model_get_iter_first (tm, &iter);
+    while (valid)
+    {
+        OssoABookContact * c = NULL, * fresh = NULL;
+        gchar * local_uid, * remote_uid;
+        gchar * remote_ebook_uid = NULL;
+
+        if (_row_is_placeholder (tm, &iter))
+        {
+            valid = gtk_tree_model_iter_next (tm, &iter);
+            continue;
+        }
+
+        gtk_tree_model_get (tm, &iter,
+            RTCOM_LOG_VIEW_COL_CONTACT, &c,
+            -1);
+
+        if (_contact_is_stale (priv, c))
+        {
+            gtk_tree_model_get (tm, &iter,
+                RTCOM_LOG_VIEW_COL_LOCAL_ACCOUNT, &local_uid,
+                RTCOM_LOG_VIEW_COL_REMOTE_ACCOUNT, &remote_uid,
+                RTCOM_LOG_VIEW_COL_ECONTACT_UID, &remote_ebook_uid,
+                -1);
+
+            if (priv->abook_aggregator_ready)
+                fresh = _get_contact_from_abook_uid (model, remote_ebook_uid);
+
+            if (fresh)
+            {
+                _populate_pixbufs (model, local_uid, remote_uid, fresh);
+                gtk_list_store_set (GTK_LIST_STORE (model), &iter,
+                    RTCOM_LOG_VIEW_COL_CONTACT, fresh,
+                    RTCOM_LOG_VIEW_COL_REMOTE_NAME,
+                        osso_abook_contact_get_display_name (fresh),
+                    -1);
+                g_object_unref (fresh);
+            }
+            else
+            {
+                /* The contact is gone, see _revert_rows_to_events() */
+                g_array_append_val (gone, iter.user_data);
+            }
+
+            g_free (local_uid);
+            g_free (remote_uid);
+            g_free (remote_ebook_uid);
+        }
+
+        if (c)
+            g_object_unref (c);
+
+        valid = gtk_tree_model_iter_next (tm, &iter);
+    }
+
+    if (gone->len > 0)
+        _revert_rows_to_events (model, gone);
+    g_array_free (gone, TRUE);
+
+    g_hash_table_remove_all (priv->stale_contacts);
+    _paged_refresh (model);
+}
+
 static gboolean
 refresh_idle_cb (gpointer model)
 {
     RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
 
-    /* If refresh-hint was a result of modifying contacts, our
-     * cache is stale. */
-    g_hash_table_remove_all (priv->cached_account_data);
+    /* If refresh-hint was a result of modifying contacts, only those
+     * are out of date. */
+    _evict_stale_contacts (model);
 
     rtcom_log_model_refresh(model);
     priv->refresh_id = 0;
@@ -2271,6 +4777,28 @@ rtcom_log_model_class_init(
             g_cclosure_marshal_VOID__VOID,
             G_TYPE_NONE,
             0);
+
+    /* Emitted around each batch of staged rows, so views can handle
+     * the inserts once per batch instead of once per row. */
+    bulk_insert_begin_signal_id = g_signal_new(
+            "bulk-insert-begin",
+            G_TYPE_FROM_CLASS(object_class),
+            G_SIGNAL_RUN_FIRST,
+            0,
+            NULL, NULL,
+            g_cclosure_marshal_VOID__VOID,
+            G_TYPE_NONE,
+            0);
+
+    bulk_insert_end_signal_id = g_signal_new(
+            "bulk-insert-end",
+            G_TYPE_FROM_CLASS(object_class),
+            G_SIGNAL_RUN_FIRST,
+            0,
+            NULL, NULL,
+            g_cclosure_marshal_VOID__VOID,
+            G_TYPE_NONE,
+            0);
 }
 
 static void _create_abook_account_manager (RTComLogModel *model);
@@ -2291,6 +4819,12 @@ _name_order_changed_cb (
     {
         OssoABookContact *contact;
 
+        if (_row_is_placeholder (GTK_TREE_MODEL (model), &iter))
+        {
+            valid = gtk_tree_model_iter_next (GTK_TREE_MODEL (model), &iter);
+            continue;
+        }
+
         gtk_tree_model_get(GTK_TREE_MODEL (model), &iter,
             RTCOM_LOG_VIEW_COL_CONTACT, &contact, -1);
 
@@ -2308,6 +4842,8 @@ _name_order_changed_cb (
 
         valid = gtk_tree_model_iter_next (GTK_TREE_MODEL (model), &iter);
     }
+
+    _paged_refresh (model);
 }
 
 static void
@@ -2338,6 +4874,10 @@ rtcom_log_model_init(
         RTCOM_LOG_VIEW_COL_TYPE_18
     };
 
+    types[RTCOM_LOG_VIEW_COL_LOCAL_ACCOUNT] = G_TYPE_POINTER;
+    types[RTCOM_LOG_VIEW_COL_SERVICE] = G_TYPE_POINTER;
+    types[RTCOM_LOG_VIEW_COL_EVENT_TYPE] = G_TYPE_POINTER;
+
     gtk_list_store_set_column_types(
             GTK_LIST_STORE(log_model),
             RTCOM_LOG_VIEW_COL_SIZE, types);
@@ -2346,12 +4886,33 @@ rtcom_log_model_init(
     priv->current_query = NULL;
     priv->filtered_services = NULL;
 
-    priv->cached_n = 0;
-    priv->done_caching = FALSE;
-
-    priv->cache_thread = NULL;
-    priv->pixbufs_thread = NULL;
-    priv->cancel_threads = FALSE;
+    priv->staging_queue = g_queue_new();
+    priv->staging_timer = g_timer_new();
+
+    priv->lazy_loading = TRUE;
+    priv->pages = g_queue_new();
+    priv->pages_to_discover = g_queue_new();
+    priv->materialize_before = G_MAXINT;
+    priv->paged_events = g_hash_table_new(g_direct_hash, g_direct_equal);
+    priv->rows_by_id = g_hash_table_new(g_direct_hash, g_direct_equal);
+    priv->new_event_ids = g_array_new(FALSE, FALSE, sizeof(gint));
+    priv->groups_by_uid = g_hash_table_new_full(g_str_hash, g_str_equal,
+            g_free, NULL);
+    priv->groups_by_uids = g_hash_table_new_full(_uid_pair_hash,
+            _uid_pair_equal, _uid_pair_free, NULL);
+    priv->groups_by_contact = g_hash_table_new_full(g_str_hash,
+            g_str_equal, g_free, NULL);
+    priv->group_stats = g_hash_table_new_full(g_direct_hash,
+            g_direct_equal, NULL, _group_stats_free);
+    priv->resolve_rows = g_hash_table_new(g_direct_hash, g_direct_equal);
+    priv->resolve_first = g_queue_new();
+    priv->visible_first = -1;
+    priv->visible_last = -1;
+    priv->changed_contacts = NULL;
+
+    priv->load = NULL;
+    priv->generation = 0;
+    priv->abandoned_loads = NULL;
 
     priv->cached_icons = g_hash_table_new_full(
             g_str_hash, g_str_equal,
@@ -2364,6 +4925,12 @@ rtcom_log_model_init(
         g_hash_table_new_full(
                 g_str_hash, g_str_equal,
                 (GDestroyNotify) g_free, (GDestroyNotify) _account_data_free);
+    priv->stale_contacts = g_hash_table_new_full(g_str_hash, g_str_equal,
+            g_free, NULL);
+    priv->unknown_contacts = g_hash_table_new_full(g_str_hash, g_str_equal,
+            g_free, g_free);
+    priv->unresolved_rows = g_hash_table_new_full(g_direct_hash,
+            g_direct_equal, NULL, g_free);
 
     priv->group_by = RTCOM_EL_QUERY_GROUP_BY_NONE;
     priv->limit = -1;
@@ -2374,7 +4941,6 @@ rtcom_log_model_init(
     priv->abook_subs = NULL;
     priv->own_aggregator = FALSE;
     priv->abook_aggregator_ready = FALSE;
-    priv->pixbufs_populated = FALSE;
     priv->in_use = FALSE;
 
     priv->vcard_field_mapping = g_hash_table_new_full (g_str_hash,
@@ -2414,6 +4980,17 @@ rtcom_log_model_init(
     if(!g_thread_supported())
         g_thread_init(NULL);
 
+    priv->pipe_lock = g_mutex_new();
+    priv->pipe_not_full = g_cond_new();
+    priv->pipe_clock = g_timer_new();
+
+    /* Always attached: it only wakes up when the queue has batches. */
+    priv->staging_source = g_source_new(&staging_source_funcs,
+            sizeof(staging_source_t));
+    ((staging_source_t *) priv->staging_source)->model = log_model;
+    g_source_set_priority(priv->staging_source, G_PRIORITY_DEFAULT_IDLE);
+    g_source_attach(priv->staging_source, NULL);
+
     _create_abook_account_manager (log_model);
 
     priv->gconf_client = gconf_client_get_default ();
@@ -2435,7 +5012,22 @@ rtcom_log_model_dispose(
 {
     RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(obj);
 
-    _priv_cancel_and_join_threads (priv);
+    /* The caching threads use the pipe and the backend, wait for
+     * them here. */
+    _priv_abandon_load (priv);
+    _priv_cancel_pending_populate (priv);
+    _priv_reap_loads (priv, TRUE);
+    _priv_cancel_purge (priv);
+    _priv_set_query_func (priv, NULL, NULL, NULL);
+    _clear_staging_queue (priv);
+    _paged_clear (priv);
+
+    if (priv->staging_source)
+    {
+        g_source_destroy (priv->staging_source);
+        g_source_unref (priv->staging_source);
+        priv->staging_source = NULL;
+    }
 
     if (priv->refresh_id)
     {
@@ -2443,6 +5035,9 @@ rtcom_log_model_dispose(
         priv->refresh_id = 0;
     }
 
+    _drop_new_events (priv);
+    _drop_resolve_queue (priv);
+
     if(priv->current_query)
     {
         g_debug(G_STRLOC ": unreffing the current query...");
@@ -2480,6 +5075,27 @@ rtcom_log_model_dispose(
             priv->aggregator_ready_closure = NULL;
         }
 
+        if (priv->contacts_added_handler)
+        {
+            g_signal_handler_disconnect (priv->abook_aggregator,
+                priv->contacts_added_handler);
+            priv->contacts_added_handler = 0;
+        }
+
+        if (priv->contacts_changed_handler)
+        {
+            g_signal_handler_disconnect (priv->abook_aggregator,
+                priv->contacts_changed_handler);
+            priv->contacts_changed_handler = 0;
+        }
+
+        if (priv->contacts_removed_handler)
+        {
+            g_signal_handler_disconnect (priv->abook_aggregator,
+                priv->contacts_removed_handler);
+            priv->contacts_removed_handler = 0;
+        }
+
         g_debug(G_STRLOC ": unreffing the aggregator...");
         g_object_unref(priv->abook_aggregator);
         priv->abook_aggregator = NULL;
@@ -2501,59 +5117,372 @@ rtcom_log_model_dispose(
             priv->display_order_notify_id);
     priv->display_order_notify_id = 0;
 
-    if (priv->gconf_client)
-        g_object_unref (priv->gconf_client);
-    priv->gconf_client = NULL;
+    if (priv->gconf_client)
+        g_object_unref (priv->gconf_client);
+    priv->gconf_client = NULL;
+
+    g_hash_table_destroy (priv->vcard_field_mapping);
+
+    G_OBJECT_CLASS(rtcom_log_model_parent_class)->dispose(obj);
+}
+
+static void
+rtcom_log_model_finalize(
+        GObject * obj)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(obj);
+
+    g_debug("Finalizing the model...");
+
+    if(priv->filtered_services)
+    {
+        guint i;
+
+        for(i = 0; priv->filtered_services[i]; i++)
+        {
+            g_free(priv->filtered_services[i]);
+        }
+        g_slice_free1(
+                sizeof(priv->filtered_services),
+                priv->filtered_services);
+    }
+
+    g_hash_table_destroy(priv->cached_icons);
+    g_hash_table_destroy(priv->cached_service_icons);
+    g_hash_table_destroy(priv->cached_account_data);
+    g_hash_table_destroy(priv->stale_contacts);
+    g_hash_table_destroy(priv->unknown_contacts);
+    g_hash_table_destroy(priv->unresolved_rows);
+    rtcom_log_phone_index_free(priv->phone_index);
+
+    g_queue_free(priv->staging_queue);
+    g_timer_destroy(priv->staging_timer);
+    g_mutex_free(priv->pipe_lock);
+    g_cond_free(priv->pipe_not_full);
+    g_timer_destroy(priv->pipe_clock);
+    g_queue_free(priv->pages);
+    g_queue_free(priv->pages_to_discover);
+    g_hash_table_destroy(priv->paged_events);
+    g_hash_table_destroy(priv->rows_by_id);
+    g_array_free(priv->new_event_ids, TRUE);
+    g_hash_table_destroy(priv->groups_by_uid);
+    g_hash_table_destroy(priv->groups_by_uids);
+    g_hash_table_destroy(priv->groups_by_contact);
+    g_hash_table_destroy(priv->group_stats);
+    g_hash_table_destroy(priv->resolve_rows);
+    g_queue_free(priv->resolve_first);
+
+    G_OBJECT_CLASS(rtcom_log_model_parent_class)->finalize(obj);
+}
+
+RTComLogModel *
+rtcom_log_model_new()
+{
+    return RTCOM_LOG_MODEL(g_object_new(RTCOM_LOG_MODEL_TYPE, NULL));
+}
+
+RTComEl *
+rtcom_log_model_get_eventlogger(
+        RTComLogModel * model)
+{
+    RTComLogModelPrivate * priv = NULL;
+
+    g_return_val_if_fail(RTCOM_IS_LOG_MODEL(model), NULL);
+
+    priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    return priv->backend;
+}
+
+guint
+rtcom_log_model_delete_events(
+        RTComLogModel * model,
+        const gint * event_ids,
+        guint n_event_ids,
+        GArray * failed_ids)
+{
+    RTComLogModelPrivate * priv = NULL;
+    GtkTreeIter iter;
+    GError * error = NULL;
+    GArray * deleted_ids;
+    guint deleted;
+    guint i;
+
+    g_return_val_if_fail(RTCOM_IS_LOG_MODEL(model), 0);
+    g_return_val_if_fail(event_ids != NULL || n_event_ids == 0, 0);
+
+    priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    g_return_val_if_fail(RTCOM_IS_EL(priv->backend), 0);
+
+    deleted_ids = g_array_sized_new(FALSE, FALSE, sizeof(gint),
+            n_event_ids);
+
+    for(i = 0; i < n_event_ids; ++i)
+    {
+        if(!rtcom_el_delete_event(priv->backend, event_ids[i], &error))
+        {
+            g_warning("%s: couldn't delete event %d: %s", G_STRFUNC,
+                    event_ids[i], error ? error->message : "unknown error");
+            g_clear_error(&error);
+            if(failed_ids)
+                g_array_append_val(failed_ids, event_ids[i]);
+            continue;
+        }
+
+        g_array_append_val(deleted_ids, event_ids[i]);
+    }
+
+    /* The event-deleted signals that follow won't find the rows
+     * anymore, so they cost a hash lookup each. */
+    for(i = 0; priv->group_by == RTCOM_EL_QUERY_GROUP_BY_NONE &&
+        i < deleted_ids->len; ++i)
+    {
+        if(_lookup_row(model, g_array_index(deleted_ids, gint, i), &iter))
+            _remove_row(model, &iter);
+    }
+
+    deleted = deleted_ids->len;
+    g_array_free(deleted_ids, TRUE);
+
+    return deleted;
+}
+
+static gboolean
+_purge_report (gpointer data)
+{
+    purge_t * purge = data;
+    RTComLogModel * model = purge->model;
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    RTComLogModelDeleteFunc func;
+    gpointer func_data;
+    GtkTreeIter iter;
+    GArray * ids;
+    GError * error;
+    guint deleted, total, i;
+    gboolean done;
+
+    g_mutex_lock(purge->lock);
+    ids = purge->deleted_ids;
+    purge->deleted_ids = g_array_new(FALSE, FALSE, sizeof(gint));
+    deleted = purge->deleted;
+    total = purge->total;
+    done = purge->done;
+    error = purge->error;
+    purge->error = NULL;
+    purge->report_id = 0;
+    g_mutex_unlock(purge->lock);
+
+    /* Ahead of the event-deleted signals, which then find nothing */
+    if(priv->group_by == RTCOM_EL_QUERY_GROUP_BY_NONE)
+    {
+        for(i = 0; i < ids->len; i++)
+        {
+            if(_lookup_row(model, g_array_index(ids, gint, i), &iter))
+                _remove_row(model, &iter);
+        }
+    }
+    g_array_free(ids, TRUE);
+
+    func = purge->func;
+    func_data = purge->data;
+
+    if(done)
+    {
+        priv->purge = NULL;
+        _purge_free(purge);
+    }
+
+    if(func)
+        func(model, deleted, total, done, error, func_data);
+
+    if(error)
+        g_error_free(error);
+
+    return FALSE;
+}
+
+/* Called with purge->lock held. Reports are coalesced, the idle picks
+ * up everything deleted until it runs. */
+static void
+_purge_schedule_report (purge_t * purge)
+{
+    if(!purge->report_id)
+        purge->report_id = g_idle_add(_purge_report, purge);
+}
+
+static gpointer
+_threaded_purge (gpointer data)
+{
+    purge_t * purge = data;
+    GArray * ids = g_array_new(FALSE, FALSE, sizeof(gint));
+    GError * error = NULL;
+    gint before_id = G_MAXINT;
+    gboolean read_all = TRUE;
+    guint n_failed = 0;
+    guint i;
+
+    /* Collect every id first: the deletions then don't shift the pages
+     * and we know how far along we are. */
+    while(!g_atomic_int_get(&purge->cancelled))
+    {
+        RTComLogEventBatch * batch =
+            rtcom_log_event_batch_new(PURGE_PAGE_SIZE);
+        guint len;
+
+        if(!_read_before(&purge->source, batch, before_id, PURGE_PAGE_SIZE))
+        {
+            rtcom_log_event_batch_free(batch);
+            read_all = FALSE;
+            break;
+        }
 
-    g_hash_table_destroy (priv->vcard_field_mapping);
+        len = rtcom_log_event_batch_len(batch);
+        for(i = 0; i < len; i++)
+        {
+            gint event_id = rtcom_log_event_batch_index(batch, i)->event_id;
 
-    G_OBJECT_CLASS(rtcom_log_model_parent_class)->dispose(obj);
-}
+            g_array_append_val(ids, event_id);
+            before_id = event_id;
+        }
+        rtcom_log_event_batch_free(batch);
 
-static void
-rtcom_log_model_finalize(
-        GObject * obj)
-{
-    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(obj);
+        if(len < PURGE_PAGE_SIZE)
+            break;
+    }
 
-    g_debug("Finalizing the model...");
+    /* Half a selection isn't what was asked for, delete none of it */
+    if(!read_all)
+        g_array_set_size(ids, 0);
 
-    if(priv->filtered_services)
+    g_mutex_lock(purge->lock);
+    purge->total = ids->len;
+    g_mutex_unlock(purge->lock);
+
+    for(i = 0; i < ids->len && !g_atomic_int_get(&purge->cancelled); i++)
     {
-        guint i;
+        gint event_id = g_array_index(ids, gint, i);
 
-        for(i = 0; priv->filtered_services[i]; i++)
+        if(!rtcom_el_delete_event(purge->source.backend, event_id, &error))
         {
-            g_free(priv->filtered_services[i]);
+            g_warning("%s: couldn't delete event %d: %s", G_STRFUNC,
+                    event_id, error ? error->message : "unknown error");
+            g_clear_error(&error);
+            n_failed++;
+            continue;
         }
-        g_slice_free1(
-                sizeof(priv->filtered_services),
-                priv->filtered_services);
+
+        g_mutex_lock(purge->lock);
+        g_array_append_val(purge->deleted_ids, event_id);
+        purge->deleted++;
+        _purge_schedule_report(purge);
+        g_mutex_unlock(purge->lock);
     }
 
-    g_hash_table_destroy(priv->cached_icons);
-    g_hash_table_destroy(priv->cached_service_icons);
-    g_hash_table_destroy(priv->cached_account_data);
+    g_array_free(ids, TRUE);
 
-    G_OBJECT_CLASS(rtcom_log_model_parent_class)->finalize(obj);
+    if(!g_atomic_int_get(&purge->cancelled))
+    {
+        g_mutex_lock(purge->lock);
+        if(!read_all)
+            g_set_error(&purge->error, RTCOM_LOG_MODEL_ERROR,
+                    RTCOM_LOG_MODEL_ERROR_READ,
+                    "Couldn't read the events to delete");
+        else if(n_failed > 0)
+            g_set_error(&purge->error, RTCOM_LOG_MODEL_ERROR,
+                    RTCOM_LOG_MODEL_ERROR_DELETE,
+                    "Couldn't delete %u of the events", n_failed);
+        purge->done = TRUE;
+        _purge_schedule_report(purge);
+        g_mutex_unlock(purge->lock);
+    }
+
+    return NULL;
 }
 
-RTComLogModel *
-rtcom_log_model_new()
+GQuark
+rtcom_log_model_error_quark (void)
 {
-    return RTCOM_LOG_MODEL(g_object_new(RTCOM_LOG_MODEL_TYPE, NULL));
+    return g_quark_from_static_string ("rtcom-log-model-error-quark");
 }
 
-RTComEl *
-rtcom_log_model_get_eventlogger(
-        RTComLogModel * model)
+gboolean
+rtcom_log_model_delete_matching(
+        RTComLogModel * model,
+        RTComLogModelDeleteFunc func,
+        gpointer data)
 {
     RTComLogModelPrivate * priv = NULL;
+    purge_t * purge;
 
-    g_return_val_if_fail(RTCOM_IS_LOG_MODEL(model), NULL);
+    g_return_val_if_fail(RTCOM_IS_LOG_MODEL(model), FALSE);
 
     priv = RTCOM_LOG_MODEL_GET_PRIV(model);
-    return priv->backend;
+    g_return_val_if_fail(RTCOM_IS_EL(priv->backend), FALSE);
+
+    if(priv->query_func == NULL)
+    {
+        g_warning("%s: the model wasn't populated with a query func",
+                G_STRFUNC);
+        return FALSE;
+    }
+
+    if(priv->purge != NULL)
+    {
+        g_warning("%s: already deleting", G_STRFUNC);
+        return FALSE;
+    }
+
+    purge = g_slice_new0(purge_t);
+    purge->model = model;
+    purge->source.model = model;
+    /* Shared with the thread the same way the caching loads share it;
+     * the event-deleted signals reach the model through it as usual. */
+    purge->source.backend = g_object_ref(priv->backend);
+    purge->source.query_func = _query_func_ref(priv->query_func);
+    purge->source.read_func = priv->read_func;
+    purge->source.group_by = RTCOM_EL_QUERY_GROUP_BY_NONE;
+    purge->lock = g_mutex_new();
+    purge->deleted_ids = g_array_new(FALSE, FALSE, sizeof(gint));
+    purge->func = func;
+    purge->data = data;
+
+    priv->purge = purge;
+    purge->thread = g_thread_create(_threaded_purge, purge, TRUE, NULL);
+    if(!purge->thread)
+    {
+        g_warning("%s: couldn't start the purge thread", G_STRFUNC);
+        priv->purge = NULL;
+        _query_func_unref(purge->source.query_func);
+        g_object_unref(purge->source.backend);
+        g_array_free(purge->deleted_ids, TRUE);
+        g_mutex_free(purge->lock);
+        g_slice_free(purge_t, purge);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* data is a copy of filtered_services, which may change while the
+ * caching thread of an abandoned load still uses it. */
+static gboolean
+_services_query_func(
+        RTComElQuery * query,
+        gint before_id,
+        gpointer data)
+{
+    gchar ** services = data;
+
+    if(services)
+        return rtcom_el_query_prepare(
+                query,
+                "service", services, RTCOM_EL_OP_IN_STRV,
+                "id", before_id, RTCOM_EL_OP_LESS,
+                NULL);
+
+    return rtcom_el_query_prepare(
+            query,
+            "id", before_id, RTCOM_EL_OP_LESS,
+            NULL);
 }
 
 void
@@ -2562,22 +5491,12 @@ rtcom_log_model_populate(
         const gchar * services[])
 {
     RTComLogModelPrivate * priv = NULL;
-    gboolean query_prepared = FALSE;
-    RTComElQuery *query = NULL;
 
     g_return_if_fail(RTCOM_IS_LOG_MODEL(model));
 
     priv = RTCOM_LOG_MODEL_GET_PRIV(model);
     g_return_if_fail(RTCOM_IS_EL(priv->backend));
 
-    priv->in_use = TRUE;
-
-    query = rtcom_el_query_new(priv->backend);
-    rtcom_el_query_set_group_by(query, priv->group_by);
-
-    rtcom_el_query_set_limit(query, priv->limit);
-    rtcom_el_query_set_offset(query, 0);
-
     if(services)
     {
         guint i, size;
@@ -2605,11 +5524,6 @@ rtcom_log_model_populate(
                 priv->filtered_services[i] = g_strdup(services[i]);
             }
         }
-
-        query_prepared = rtcom_el_query_prepare(
-                query,
-                "service", priv->filtered_services, RTCOM_EL_OP_IN_STRV,
-                NULL);
     }
     else
     {
@@ -2624,44 +5538,76 @@ rtcom_log_model_populate(
             g_free(priv->filtered_services);
             priv->filtered_services = NULL;
         }
-
-        query_prepared = rtcom_el_query_prepare(query, NULL);
     }
 
-    if(!query_prepared)
-    {
-        g_warning("Couldn't prepare query");
-        g_object_unref(query);
-        query = NULL;
-        return;
-    }
+    rtcom_log_model_populate_query_func(model, _services_query_func,
+            g_strdupv(priv->filtered_services), (GDestroyNotify) g_strfreev);
+}
+
+
+static void
+_populate_with_query(
+        RTComLogModel * model,
+        RTComElQuery *query);
+
+static gboolean
+_pending_populate_cb (gpointer data)
+{
+    RTComLogModel * model = data;
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    RTComElQuery * query = priv->pending_query;
+
+    if (_priv_query_in_use (priv, query))
+        return TRUE;
 
-    rtcom_log_model_populate_query(model, query);
+    priv->pending_populate_id = 0;
+    priv->pending_query = NULL;
+
+    _populate_with_query (model, query);
     g_object_unref (query);
-}
 
+    return FALSE;
+}
 
-void
-rtcom_log_model_populate_query(
+static void
+_populate_with_query(
         RTComLogModel * model,
         RTComElQuery *query)
 {
-    RTComLogModelPrivate * priv = NULL;
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
     RTComElIter * it = NULL;
-    GHashTable * values = NULL;
     caching_data_t * d = NULL;
-    guint event_count = 0;
+    load_t * load;
     gint limit;
 
-    g_return_if_fail(RTCOM_IS_LOG_MODEL(model));
-
-    priv = RTCOM_LOG_MODEL_GET_PRIV(model);
-    g_return_if_fail(RTCOM_IS_EL(priv->backend));
-
     priv->in_use = TRUE;
 
     rtcom_log_model_clear (model);
 
+    /* Without a query func the caching thread pages the caller's query
+     * object itself. If an abandoned thread is still doing that, the
+     * list stays empty until it has noticed and exited, rather than
+     * blocking here on whatever it is reading. */
+    if (!priv->query_func && _priv_query_in_use (priv, query))
+    {
+        priv->pending_query = g_object_ref (query);
+        priv->pending_populate_id = g_timeout_add (POPULATE_RETRY_MS,
+                _pending_populate_cb, model);
+        return;
+    }
+
+    priv->stats_rows = 0;
+    priv->stats_time = 0;
+    priv->stats_longest_stall = 0;
+
+    g_mutex_lock(priv->pipe_lock);
+    priv->pipe_max_depth = 0;
+    priv->pipe_read_batches = 0;
+    priv->pipe_read_time = 0;
+    priv->pipe_staged_batches = 0;
+    priv->pipe_wait_time = 0;
+    g_mutex_unlock(priv->pipe_lock);
+
     if(priv->current_query != NULL)
     {
         g_debug("Unreffing the previous query.");
@@ -2674,52 +5620,62 @@ rtcom_log_model_populate_query(
      * load the data in stages. If the user wants to
      * limit the number of results, they should do so
      * using rtcom_log_model_set_limit() instead. */
-    limit = MAX_CACHED_PER_QUERY_FIRST;
+    limit = _cached_per_query(priv, TRUE);
     if ((priv->limit != -1) && (priv->limit < limit))
         limit = priv->limit;
 
     rtcom_el_query_set_limit(query, limit);
     rtcom_el_query_set_offset(query, 0);
-    rtcom_el_query_refresh(query);
 
-    it = rtcom_el_get_events(priv->backend, priv->current_query);
+    /* Only unlimited, ungrouped results we can page by id get lazily
+     * loaded past the first page. */
+    priv->paged = priv->lazy_loading && priv->limit == -1 &&
+        priv->query_func != NULL &&
+        priv->group_by == RTCOM_EL_QUERY_GROUP_BY_NONE;
+
+    load = priv->load = g_slice_new0(load_t);
+    load->model = model;
+    load->generation = (guint) g_atomic_int_get(&priv->generation);
+    load->finished = TRUE;
+    load->backend = priv->backend;
+    load->query = g_object_ref(query);
+    load->query_func = _query_func_ref(priv->query_func);
+    load->read_func = priv->read_func;
+    load->group_by = priv->group_by;
+    load->limit = priv->limit;
+    load->paged = priv->paged;
+    load->show_group_chat = priv->show_group_chat;
+    load->seek_id = G_MAXINT;
+
+    if(load->query_func &&
+       !load->query_func->func(query, load->seek_id, load->query_func->data))
+    {
+        g_warning("Couldn't prepare query");
+        return;
+    }
 
-    d = g_new0(caching_data_t, 1);
-    d->model = model;
-    d->prepend = FALSE;
+    d = _caching_data_new(model, FALSE, limit);
 
-    priv->cached_n = 0;
-    if(it && rtcom_el_iter_first(it))
+    if(!_read_direct(load, d->batch, load->seek_id, limit))
     {
-        do
-        {
-            event_count++;
-            values = rtcom_el_iter_get_value_map(
-                    it,
-                    "id",
-                    "service",
-                    "group-uid",
-                    "local-uid",
-                    "remote-uid",
-                    "remote-name",
-                    "remote-ebook-uid",
-                    "content",
-                    "icon-name",
-                    "start-time",
-                    "end-time",
-                    "event-count",
-                    "group-title",
-                    "event-type",
-                    "outgoing",
-                    "flags",
-                    NULL);
-            d->cached_events = g_list_prepend(d->cached_events, values);
-        } while(rtcom_el_iter_next(it));
+        rtcom_el_query_refresh(query);
 
-        g_object_unref(it);
+        it = rtcom_el_get_events(priv->backend, priv->current_query);
+        if(it && rtcom_el_iter_first(it))
+        {
+            do
+            {
+                rtcom_log_event_batch_append_iter(d->batch, it);
+            } while(rtcom_el_iter_next(it));
+        }
+        if(it)
+            g_object_unref(it);
     }
 
-    priv->cached_n += event_count;
+    load->cached_n = rtcom_log_event_batch_len(d->batch);
+    if(rtcom_log_event_batch_len(d->batch) > 0)
+        load->seek_id = rtcom_log_event_batch_index(d->batch,
+                rtcom_log_event_batch_len(d->batch) - 1)->event_id;
 
     /* Create the aggregator now, if it doesn't exist already, before
      * starging to stage the events.
@@ -2729,21 +5685,65 @@ rtcom_log_model_populate_query(
         _create_own_aggregator(model);
     }
 
-    d->cached_events = g_list_reverse(d->cached_events);
-    _stage_cached(d);
+    _stage_cached_now(d);
 
-    if ((priv->cached_n == MAX_CACHED_PER_QUERY_FIRST) &&
-        (priv->limit > priv->cached_n))
+    if ((load->cached_n == limit) &&
+        (load->limit == -1 || load->limit > load->cached_n))
     {
-        priv->cancel_threads = FALSE;
-        priv->done_caching = FALSE;
-        priv->cache_thread = g_thread_create(
+        load->finished = FALSE;
+        load->thread = g_thread_create(
                 (GThreadFunc) _threaded_cached_load,
-                model,
+                load,
                 TRUE, NULL);
+        if (!load->thread)
+            load->finished = TRUE;
     }
 }
 
+void
+rtcom_log_model_populate_query(
+        RTComLogModel * model,
+        RTComElQuery *query)
+{
+    RTComLogModelPrivate * priv = NULL;
+
+    g_return_if_fail(RTCOM_IS_LOG_MODEL(model));
+
+    priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    g_return_if_fail(RTCOM_IS_EL(priv->backend));
+
+    /* We know nothing about the conditions of a caller's query, so
+     * this one can only be paged by offset. */
+    _priv_set_query_func (priv, NULL, NULL, NULL);
+
+    _populate_with_query (model, query);
+}
+
+void
+rtcom_log_model_populate_query_func(
+        RTComLogModel * model,
+        RTComLogModelQueryFunc func,
+        gpointer data,
+        GDestroyNotify destroy)
+{
+    RTComLogModelPrivate * priv = NULL;
+    RTComElQuery * query = NULL;
+
+    g_return_if_fail(RTCOM_IS_LOG_MODEL(model));
+    g_return_if_fail(func != NULL);
+
+    priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    g_return_if_fail(RTCOM_IS_EL(priv->backend));
+
+    _priv_set_query_func (priv, func, data, destroy);
+
+    query = rtcom_el_query_new(priv->backend);
+    rtcom_el_query_set_group_by(query, priv->group_by);
+
+    _populate_with_query (model, query);
+    g_object_unref (query);
+}
+
 void
 rtcom_log_model_clear(RTComLogModel *model)
 {
@@ -2753,10 +5753,234 @@ rtcom_log_model_clear(RTComLogModel *model)
 
     priv = RTCOM_LOG_MODEL_GET_PRIV(model);
 
-    _priv_cancel_and_join_threads (priv);
+    _priv_abandon_load (priv);
+    _priv_cancel_pending_populate (priv);
+    _clear_staging_queue (priv);
+    _paged_clear (priv);
+    /* Whatever reloads the list reads them too */
+    _drop_new_events (priv);
 
     g_debug("%s: clearing the list store", G_STRFUNC);
-    gtk_list_store_clear(GTK_LIST_STORE(model));
+    _clear_rows(model);
+}
+
+/* Sets the values of the row that can change for the same event, if
+ * they did. */
+static void
+_update_event_row (RTComLogModel * model, GtkTreeIter * iter,
+        RTComLogEvent * event)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    GdkPixbuf * icon = _lookup_icon(priv, event->icon_name);
+    GdkPixbuf * icon_iter = NULL;
+    OssoABookContact * contact_iter = NULL;
+    gchar * text_iter = NULL, * group_title_iter = NULL;
+    gchar * remote_name_iter = NULL, * remote_ebook_uid_iter = NULL;
+    gint count_iter, flags_iter, timestamp_iter, end_timestamp_iter;
+
+    gtk_tree_model_get(
+            GTK_TREE_MODEL(model), iter,
+            RTCOM_LOG_VIEW_COL_ICON, &icon_iter,
+            RTCOM_LOG_VIEW_COL_TEXT, &text_iter,
+            RTCOM_LOG_VIEW_COL_GROUP_TITLE, &group_title_iter,
+            RTCOM_LOG_VIEW_COL_COUNT, &count_iter,
+            RTCOM_LOG_VIEW_COL_FLAGS, &flags_iter,
+            RTCOM_LOG_VIEW_COL_TIMESTAMP, &timestamp_iter,
+            RTCOM_LOG_VIEW_COL_END_TIMESTAMP, &end_timestamp_iter,
+            RTCOM_LOG_VIEW_COL_REMOTE_NAME, &remote_name_iter,
+            RTCOM_LOG_VIEW_COL_ECONTACT_UID, &remote_ebook_uid_iter,
+            RTCOM_LOG_VIEW_COL_CONTACT, &contact_iter,
+            -1);
+
+    if(icon_iter != icon ||
+       g_strcmp0(text_iter, event->text) != 0 ||
+       g_strcmp0(group_title_iter, event->group_title) != 0 ||
+       count_iter != event->count ||
+       flags_iter != event->flags ||
+       timestamp_iter != event->timestamp ||
+       end_timestamp_iter != event->end_timestamp)
+    {
+        gtk_list_store_set(
+                GTK_LIST_STORE(model), iter,
+                RTCOM_LOG_VIEW_COL_ICON, icon,
+                RTCOM_LOG_VIEW_COL_TEXT, event->text,
+                RTCOM_LOG_VIEW_COL_GROUP_TITLE, event->group_title,
+                RTCOM_LOG_VIEW_COL_COUNT, event->count,
+                RTCOM_LOG_VIEW_COL_FLAGS, event->flags,
+                RTCOM_LOG_VIEW_COL_TIMESTAMP, event->timestamp,
+                RTCOM_LOG_VIEW_COL_END_TIMESTAMP, event->end_timestamp,
+                -1);
+    }
+
+    /* The event got linked to another contact, or a row without one has
+     * other details to find it by: start over from what the event has
+     * and let the resolution idle look the contact up again. A contact
+     * the row has already keeps its display name up to date itself. */
+    if((event->remote_ebook_uid &&
+        g_strcmp0(remote_ebook_uid_iter, event->remote_ebook_uid) != 0) ||
+       (!contact_iter &&
+        g_strcmp0(remote_name_iter, event->remote_name) != 0))
+    {
+        _unindex_group(model, iter);
+        gtk_list_store_set(
+                GTK_LIST_STORE(model), iter,
+                RTCOM_LOG_VIEW_COL_CONTACT, NULL,
+                RTCOM_LOG_VIEW_COL_REMOTE_NAME, event->remote_name,
+                RTCOM_LOG_VIEW_COL_ECONTACT_UID, event->remote_ebook_uid,
+                -1);
+        _index_group(model, iter);
+
+        if(event->local_uid && event->remote_uid)
+            _queue_resolve(model, iter);
+    }
+
+    if(icon_iter)
+        g_object_unref(icon_iter);
+    if(contact_iter)
+        g_object_unref(contact_iter);
+    g_free(text_iter);
+    g_free(group_title_iter);
+    g_free(remote_name_iter);
+    g_free(remote_ebook_uid_iter);
+}
+
+/* Re-reads the events shown and brings the store in line with them by
+ * event id: new rows are inserted, gone ones removed, moved ones moved
+ * and changed ones updated. Rows kept stay put for the view, along with
+ * its scroll position. Returns FALSE, touching nothing, if the list is
+ * still loading or staging, lazily loaded or too long for it. */
+static gboolean
+_refresh_in_place (RTComLogModel * model)
+{
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    load_t * load = priv->load;
+    RTComLogEventBatch * batch;
+    GtkTreeIter iter, cursor;
+    group_stats_t * stats;
+    gboolean cursor_valid;
+    gint limit = REFRESH_DIFF_MAX_ROWS + 1;
+    guint i;
+
+    if(!load || !g_atomic_int_get(&load->finished) || priv->paged ||
+       GTK_LIST_STORE(model)->length > REFRESH_DIFF_MAX_ROWS)
+        return FALSE;
+
+    /* Batches read but not staged yet would go in on top of the diff */
+    if(priv->staging_current || !_pipe_is_empty(priv))
+        return FALSE;
+
+    /* The rows were loaded with other settings, which the next load
+     * picks up; they'd all have to be regrouped or read another way. */
+    if(load->group_by != priv->group_by ||
+       load->show_group_chat != priv->show_group_chat ||
+       load->read_func != priv->read_func)
+        return FALSE;
+
+    if(priv->limit != -1 && priv->limit < limit)
+        limit = priv->limit;
+
+    batch = rtcom_log_event_batch_new(limit);
+
+    if(!_read_direct(load, batch, G_MAXINT, limit))
+    {
+        RTComElQuery * query;
+        RTComElIter * it;
+
+        if(load->query_func)
+        {
+            query = rtcom_el_query_new(priv->backend);
+            rtcom_el_query_set_group_by(query, priv->group_by);
+            rtcom_el_query_set_limit(query, limit);
+            rtcom_el_query_set_offset(query, 0);
+            if(!load->query_func->func(query, G_MAXINT,
+                        load->query_func->data))
+            {
+                g_warning("Couldn't prepare query");
+                g_object_unref(query);
+                rtcom_log_event_batch_free(batch);
+                return FALSE;
+            }
+        }
+        else
+        {
+            query = g_object_ref(priv->current_query);
+            rtcom_el_query_set_limit(query, limit);
+            rtcom_el_query_set_offset(query, 0);
+            if(!rtcom_el_query_refresh(query))
+            {
+                g_object_unref(query);
+                rtcom_log_event_batch_free(batch);
+                return FALSE;
+            }
+        }
+
+        it = rtcom_el_get_events(priv->backend, query);
+        if(it && rtcom_el_iter_first(it))
+        {
+            do
+            {
+                rtcom_log_event_batch_append_iter(batch, it);
+            } while(rtcom_el_iter_next(it));
+        }
+        if(it)
+            g_object_unref(it);
+        g_object_unref(query);
+    }
+
+    _decode_batch(load, batch);
+
+    /* Grown past what we diff, reload it in stages instead */
+    if(rtcom_log_event_batch_len(batch) > REFRESH_DIFF_MAX_ROWS)
+    {
+        rtcom_log_event_batch_free(batch);
+        return FALSE;
+    }
+
+    /* The read has them all */
+    _drop_new_events(priv);
+
+    g_signal_emit(model, bulk_insert_begin_signal_id, 0);
+
+    /* cursor is the row at position i, the first one not matched yet */
+    cursor_valid = gtk_tree_model_get_iter_first(GTK_TREE_MODEL(model),
+            &cursor);
+
+    for(i = 0; i < rtcom_log_event_batch_len(batch); i++)
+    {
+        RTComLogEvent * event = rtcom_log_event_batch_index(batch, i);
+
+        if(!_lookup_row(model, event->event_id, &iter))
+        {
+            _insert_event_row(model, batch, event, i, &iter);
+            _index_group(model, &iter);
+            _track_group(priv, &iter, event, NULL, TRUE);
+            continue;
+        }
+
+        if(cursor_valid && iter.user_data == cursor.user_data)
+            cursor_valid = gtk_tree_model_iter_next(GTK_TREE_MODEL(model),
+                    &cursor);
+        else
+            gtk_list_store_move_before(GTK_LIST_STORE(model), &iter,
+                    cursor_valid ? &cursor : NULL);
+
+        _update_event_row(model, &iter, event);
+
+        stats = g_hash_table_lookup(priv->group_stats, iter.user_data);
+        if(stats)
+            stats->count = event->count;
+    }
+
+    /* Whatever is left didn't come back */
+    while(cursor_valid)
+        cursor_valid = _remove_row(model, &cursor);
+
+    g_signal_emit(model, bulk_insert_end_signal_id, 0);
+
+    load->cached_n = rtcom_log_event_batch_len(batch);
+    rtcom_log_event_batch_free(batch);
+
+    return TRUE;
 }
 
 void
@@ -2773,10 +5997,16 @@ rtcom_log_model_refresh(
     if (priv->current_query == NULL)
         return;
 
+    if (_refresh_in_place (model))
+    {
+        g_debug("%s: refreshed the model in place", G_STRFUNC);
+        return;
+    }
+
     g_debug("%s: repopulating the model", G_STRFUNC);
 
     query = g_object_ref (priv->current_query);
-    rtcom_log_model_populate_query (model, query);
+    _populate_with_query (model, query);
     g_object_unref (query);
 }
 
@@ -2798,10 +6028,20 @@ rtcom_log_model_set_limit(
       gint limit)
 {
     RTComLogModelPrivate * priv = NULL;
+    GtkTreeIter iter;
 
     g_return_if_fail(RTCOM_IS_LOG_MODEL(model));
     priv = RTCOM_LOG_MODEL_GET_PRIV(model);
     priv->limit = limit;
+
+    /* The placeholder rows of a lazy load only go with the next
+     * populate, as the pages are read by position. */
+    if (limit == -1 || priv->paged)
+        return;
+
+    while ((gint) GTK_LIST_STORE(model)->length > limit &&
+           _last_row(model, &iter))
+        _remove_row(model, &iter);
 }
 
 void
@@ -2850,6 +6090,44 @@ rtcom_log_model_set_abook_aggregator(
     }
 }
 
+static GdkPixbuf *
+_lookup_service_icon (RTComLogModelPrivate * priv, const gchar * icon_name)
+{
+    GdkPixbuf * service_icon;
+
+    service_icon = g_hash_table_lookup(
+            priv->cached_service_icons,
+            icon_name);
+
+    if(!service_icon)
+    {
+        GdkPixbuf * tmp;
+
+        tmp = gtk_icon_theme_load_icon(
+                gtk_icon_theme_get_default(),
+                icon_name,
+                HILDON_ICON_PIXEL_SIZE_SMALL,
+                0, NULL);
+        if(!tmp)
+            return NULL;
+
+        service_icon = gdk_pixbuf_scale_simple(
+                tmp,
+                HILDON_ICON_PIXEL_SIZE_SMALL,
+                HILDON_ICON_PIXEL_SIZE_SMALL,
+                GDK_INTERP_NEAREST);
+
+        g_object_unref(tmp);
+
+        g_hash_table_insert(
+                priv->cached_service_icons,
+                g_strdup(icon_name),
+                service_icon);
+    }
+
+    return service_icon;
+}
+
 static const GdkPixbuf *
 _get_service_icon (RTComLogModel *model, const gchar *local_uid)
 {
@@ -2858,7 +6136,6 @@ _get_service_icon (RTComLogModel *model, const gchar *local_uid)
     McProfile *profile;
     const gchar *id;
     const gchar *icon_name;
-    GtkIconTheme * icon_theme;
     GdkPixbuf * service_icon;
 
     if (!osso_abook_waitable_is_ready(
@@ -2888,35 +6165,7 @@ _get_service_icon (RTComLogModel *model, const gchar *local_uid)
     if (!icon_name)
       return NULL;
 
-    icon_theme = gtk_icon_theme_get_default();
-
-    service_icon = g_hash_table_lookup(
-            priv->cached_service_icons,
-            icon_name);
-
-    if(!service_icon)
-    {
-        GdkPixbuf * tmp;
-
-        tmp = gtk_icon_theme_load_icon(
-                icon_theme,
-                icon_name,
-                HILDON_ICON_PIXEL_SIZE_SMALL,
-                0, NULL);
-
-        service_icon = gdk_pixbuf_scale_simple(
-                tmp,
-                HILDON_ICON_PIXEL_SIZE_SMALL,
-                HILDON_ICON_PIXEL_SIZE_SMALL,
-                GDK_INTERP_NEAREST);
-
-        g_object_unref(tmp);
-
-        g_hash_table_insert(
-                priv->cached_service_icons,
-                g_strdup(icon_name),
-                service_icon);
-    }
+    service_icon = _lookup_service_icon (priv, icon_name);
 
     g_debug ("%s: got icon %s for account %s", G_STRFUNC,
         icon_name, local_uid);
@@ -2948,6 +6197,12 @@ _account_manager_ready(
         gchar *local_uid;
         GdkPixbuf *icon;
 
+        if (_row_is_placeholder (GTK_TREE_MODEL(model), &iter))
+        {
+            valid = gtk_tree_model_iter_next(GTK_TREE_MODEL(model), &iter);
+            continue;
+        }
+
         gtk_tree_model_get(
                 GTK_TREE_MODEL(model), &iter,
                 RTCOM_LOG_VIEW_COL_LOCAL_ACCOUNT, &local_uid,
@@ -2975,6 +6230,8 @@ _account_manager_ready(
                 GTK_TREE_MODEL(model),
                 &iter);
     }
+
+    _paged_refresh (model);
 }
 
 static void
@@ -3056,6 +6313,7 @@ rtcom_log_model_filter_visible_func (GtkTreeModel *model,
     glong len = 0;
     gssize size;
     gchar * displayed_name;
+    gchar * remote_uid = NULL;
     gboolean result = FALSE;
     gchar * haystack;
     gchar * haypart;
@@ -3076,11 +6334,13 @@ rtcom_log_model_filter_visible_func (GtkTreeModel *model,
 
     if (!displayed_name)
         gtk_tree_model_get (model, iter,
-            RTCOM_LOG_VIEW_COL_REMOTE_ACCOUNT, &displayed_name, -1);
+            RTCOM_LOG_VIEW_COL_REMOTE_ACCOUNT, &remote_uid, -1);
 
     needle = g_utf8_strdown(text, -1);
-    haystack = g_utf8_strdown(displayed_name, -1);
+    haystack = g_utf8_strdown(
+            displayed_name ? displayed_name : remote_uid, -1);
     g_free (displayed_name);
+    g_free (remote_uid);
 
     /*tokenizing needle*/
     for (needle_part = needle;
@@ -3126,5 +6386,471 @@ rtcom_log_model_set_show_group_chat (
     rtcom_log_model_refresh(model);
 }
 
+void
+rtcom_log_model_set_lazy_loading (
+        RTComLogModel * model,
+        gboolean lazy)
+{
+    RTComLogModelPrivate *priv;
+
+    g_return_if_fail (RTCOM_IS_LOG_MODEL (model));
+    priv = RTCOM_LOG_MODEL_GET_PRIV (model);
+
+    priv->lazy_loading = lazy;
+}
+
+/* Replaces the placeholders with full rows, a page at a time, going
+ * back from the most recent one. Rows the caching thread stages from
+ * now on are full ones anyway. */
+static gboolean
+_materialize_idle (gpointer data)
+{
+    RTComLogModel * model = RTCOM_LOG_MODEL(data);
+    RTComLogModelPrivate * priv = RTCOM_LOG_MODEL_GET_PRIV(model);
+    GtkTreeModel * tm = GTK_TREE_MODEL(model);
+    load_t * load = priv->load;
+    RTComLogEventBatch * batch;
+    guint i, n = 0;
+
+    if(priv->searching && load && load->query_func)
+    {
+        batch = rtcom_log_event_batch_new(MATERIALIZE_PER_IDLE);
+
+        if(_read_before(load, batch, priv->materialize_before,
+                    MATERIALIZE_PER_IDLE))
+            n = rtcom_log_event_batch_len(batch);
+        if(n > 0)
+            priv->materialize_before =
+                rtcom_log_event_batch_index(batch, n - 1)->event_id;
+
+        _decode_batch(load, batch);
+
+        for(i = 0; i < rtcom_log_event_batch_len(batch); i++)
+        {
+            RTComLogEvent * event = rtcom_log_event_batch_index(batch, i);
+            GtkTreeIter placeholder, iter;
+            GtkTreePath * path;
+
+            if(!_lookup_row(model, event->event_id, &placeholder) ||
+               !_row_is_placeholder(tm, &placeholder))
+                continue;
+
+            path = gtk_tree_model_get_path(tm, &placeholder);
+            _insert_event_row(model, batch, event,
+                    gtk_tree_path_get_indices(path)[0], &iter);
+            gtk_tree_path_free(path);
+
+            _remove_row(model, &placeholder);
+        }
+
+        rtcom_log_event_batch_free(batch);
+
+        if(n == MATERIALIZE_PER_IDLE)
+            return TRUE;
+
+        /* Nothing is left to read lazily */
+        if(load->finished)
+        {
+            priv->materialize_id = 0;
+            _paged_clear(priv);
+            priv->paged = FALSE;
+            return FALSE;
+        }
+
+        /* The caching thread stages the rest. Should it stage
+         * placeholders again, once the search is over, the next one has
+         * to start over. */
+        priv->materialize_before = G_MAXINT;
+    }
+
+    priv->materialize_id = 0;
+    return FALSE;
+}
+
+void
+rtcom_log_model_set_searching (
+        RTComLogModel * model,
+        gboolean searching)
+{
+    RTComLogModelPrivate *priv;
+
+    g_return_if_fail (RTCOM_IS_LOG_MODEL (model));
+    priv = RTCOM_LOG_MODEL_GET_PRIV (model);
+
+    priv->searching = searching;
+
+    if (searching && priv->paged && !priv->materialize_id)
+        priv->materialize_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+            _materialize_idle, model, NULL);
+}
+
+void
+rtcom_log_model_set_visible_range (
+        RTComLogModel * model,
+        GtkTreePath * first,
+        GtkTreePath * last)
+{
+    RTComLogModelPrivate *priv;
+    GtkTreeIter iter;
+    gint i;
+    gboolean valid;
+
+    g_return_if_fail (RTCOM_IS_LOG_MODEL (model));
+    priv = RTCOM_LOG_MODEL_GET_PRIV (model);
+
+    if (!first || !last)
+    {
+        priv->visible_first = -1;
+        priv->visible_last = -1;
+        return;
+    }
+
+    if (priv->visible_first == gtk_tree_path_get_indices (first)[0] &&
+        priv->visible_last == gtk_tree_path_get_indices (last)[0])
+        return;
+
+    priv->visible_first = gtk_tree_path_get_indices (first)[0];
+    priv->visible_last = gtk_tree_path_get_indices (last)[0];
+
+    if (g_hash_table_size (priv->resolve_rows) == 0)
+        return;
+
+    valid = gtk_tree_model_iter_nth_child (GTK_TREE_MODEL (model), &iter,
+        NULL, priv->visible_first);
+    for (i = priv->visible_first; valid && i <= priv->visible_last; i++)
+    {
+        _resolve_first (priv, &iter);
+        valid = gtk_tree_model_iter_next (GTK_TREE_MODEL (model), &iter);
+    }
+}
+
+void
+rtcom_log_model_set_read_func (
+        RTComLogModel * model,
+        RTComLogModelReadFunc func)
+{
+    RTComLogModelPrivate *priv;
+
+    g_return_if_fail (RTCOM_IS_LOG_MODEL (model));
+    priv = RTCOM_LOG_MODEL_GET_PRIV (model);
+
+    priv->read_func = func;
+}
+
+void
+rtcom_log_model_get_staging_stats (
+        RTComLogModel * model,
+        gdouble * rows_per_second,
+        gdouble * longest_stall_ms)
+{
+    RTComLogModelPrivate *priv;
+
+    g_return_if_fail (RTCOM_IS_LOG_MODEL (model));
+    priv = RTCOM_LOG_MODEL_GET_PRIV (model);
+
+    if (rows_per_second)
+        *rows_per_second = priv->stats_time > 0 ?
+            priv->stats_rows / priv->stats_time : 0;
+    if (longest_stall_ms)
+        *longest_stall_ms = priv->stats_longest_stall * 1000;
+}
+
+void
+rtcom_log_model_get_discovery_stats (
+        RTComLogModel * model,
+        guint * hits,
+        guint * misses)
+{
+    RTComLogModelPrivate *priv;
+
+    g_return_if_fail (RTCOM_IS_LOG_MODEL (model));
+    priv = RTCOM_LOG_MODEL_GET_PRIV (model);
+
+    if (hits)
+        *hits = priv->discovery_hits;
+    if (misses)
+        *misses = priv->discovery_misses;
+}
+
+void
+rtcom_log_model_get_pipeline_stats (
+        RTComLogModel * model,
+        guint * queue_depth,
+        guint * max_queue_depth,
+        gdouble * read_ms,
+        gdouble * queue_wait_ms)
+{
+    RTComLogModelPrivate *priv;
+
+    g_return_if_fail (RTCOM_IS_LOG_MODEL (model));
+    priv = RTCOM_LOG_MODEL_GET_PRIV (model);
+
+    g_mutex_lock (priv->pipe_lock);
+
+    if (queue_depth)
+        *queue_depth = g_queue_get_length (priv->staging_queue);
+    if (max_queue_depth)
+        *max_queue_depth = priv->pipe_max_depth;
+    if (read_ms)
+        *read_ms = priv->pipe_read_batches > 0 ?
+            priv->pipe_read_time * 1000 / priv->pipe_read_batches : 0;
+    if (queue_wait_ms)
+        *queue_wait_ms = priv->pipe_staged_batches > 0 ?
+            priv->pipe_wait_time * 1000 / priv->pipe_staged_batches : 0;
+
+    g_mutex_unlock (priv->pipe_lock);
+}
+
+/* The name a cached icon was loaded by, NULL if it isn't one of ours. */
+static const gchar *
+_icon_name_of (GHashTable * icons, gconstpointer icon)
+{
+    GHashTableIter it;
+    gpointer name, value;
+
+    if (!icon)
+        return NULL;
+
+    g_hash_table_iter_init (&it, icons);
+    while (g_hash_table_iter_next (&it, &name, &value))
+    {
+        if (value == icon)
+            return name;
+    }
+
+    return NULL;
+}
+
+static void
+_key_file_set_string (GKeyFile * key_file, const gchar * group,
+        const gchar * key, const gchar * value)
+{
+    if (value)
+        g_key_file_set_string (key_file, group, key, value);
+}
+
+static gchar *
+_key_file_get_string (GKeyFile * key_file, const gchar * group,
+        const gchar * key)
+{
+    return g_key_file_get_string (key_file, group, key, NULL);
+}
+
+static const gchar *
+_key_file_get_interned (GKeyFile * key_file, const gchar * group,
+        const gchar * key)
+{
+    gchar * str = _key_file_get_string (key_file, group, key);
+    const gchar * interned = g_intern_string (str);
+
+    g_free (str);
+    return interned;
+}
+
+guint
+rtcom_log_model_save_snapshot (
+        RTComLogModel * model,
+        GKeyFile * key_file,
+        guint n_rows)
+{
+    RTComLogModelPrivate *priv;
+    GtkTreeModel * tree_model;
+    GtkTreeIter iter;
+    gboolean valid;
+    guint n = 0;
+
+    g_return_val_if_fail (RTCOM_IS_LOG_MODEL (model), 0);
+    g_return_val_if_fail (key_file != NULL, 0);
+
+    priv = RTCOM_LOG_MODEL_GET_PRIV (model);
+    tree_model = GTK_TREE_MODEL (model);
+
+    for (valid = gtk_tree_model_get_iter_first (tree_model, &iter);
+         valid && n < n_rows;
+         valid = gtk_tree_model_iter_next (tree_model, &iter))
+    {
+        GdkPixbuf * icon = NULL, * service_icon = NULL;
+        OssoABookContact * contact = NULL;
+        gchar * text = NULL, * remote_name = NULL, * econtact_uid = NULL,
+              * group_uid = NULL, * group_title = NULL, * local_uid = NULL,
+              * remote_uid = NULL, * service = NULL, * event_type = NULL;
+        const gchar * display_name = NULL;
+        gint event_id, timestamp, end_timestamp, count, flags;
+        gboolean outgoing;
+        gchar * group;
+
+        gtk_tree_model_get (tree_model, &iter,
+                RTCOM_LOG_VIEW_COL_ICON, &icon,
+                RTCOM_LOG_VIEW_COL_TEXT, &text,
+                RTCOM_LOG_VIEW_COL_CONTACT, &contact,
+                RTCOM_LOG_VIEW_COL_SERVICE_ICON, &service_icon,
+                RTCOM_LOG_VIEW_COL_LOCAL_ACCOUNT, &local_uid,
+                RTCOM_LOG_VIEW_COL_REMOTE_ACCOUNT, &remote_uid,
+                RTCOM_LOG_VIEW_COL_REMOTE_NAME, &remote_name,
+                RTCOM_LOG_VIEW_COL_ECONTACT_UID, &econtact_uid,
+                RTCOM_LOG_VIEW_COL_EVENT_ID, &event_id,
+                RTCOM_LOG_VIEW_COL_SERVICE, &service,
+                RTCOM_LOG_VIEW_COL_GROUP_UID, &group_uid,
+                RTCOM_LOG_VIEW_COL_TIMESTAMP, &timestamp,
+                RTCOM_LOG_VIEW_COL_END_TIMESTAMP, &end_timestamp,
+                RTCOM_LOG_VIEW_COL_COUNT, &count,
+                RTCOM_LOG_VIEW_COL_GROUP_TITLE, &group_title,
+                RTCOM_LOG_VIEW_COL_EVENT_TYPE, &event_type,
+                RTCOM_LOG_VIEW_COL_OUTGOING, &outgoing,
+                RTCOM_LOG_VIEW_COL_FLAGS, &flags,
+                -1);
+
+        /* The contact itself can't be saved, keep the name it shows */
+        if (contact)
+            display_name = osso_abook_contact_get_display_name (contact);
+        if (!display_name)
+            display_name = remote_name;
+
+        group = g_strdup_printf ("row%u", n);
+
+        g_key_file_set_integer (key_file, group, "event-id", event_id);
+        _key_file_set_string (key_file, group, "icon",
+                _icon_name_of (priv->cached_icons, icon));
+        _key_file_set_string (key_file, group, "service-icon",
+                _icon_name_of (priv->cached_service_icons, service_icon));
+        _key_file_set_string (key_file, group, "text", text);
+        _key_file_set_string (key_file, group, "local-uid", local_uid);
+        _key_file_set_string (key_file, group, "remote-uid", remote_uid);
+        _key_file_set_string (key_file, group, "remote-name", display_name);
+        _key_file_set_string (key_file, group, "econtact-uid", econtact_uid);
+        _key_file_set_string (key_file, group, "service", service);
+        _key_file_set_string (key_file, group, "group-uid", group_uid);
+        g_key_file_set_integer (key_file, group, "start-time", timestamp);
+        g_key_file_set_integer (key_file, group, "end-time", end_timestamp);
+        g_key_file_set_integer (key_file, group, "count", count);
+        _key_file_set_string (key_file, group, "group-title", group_title);
+        _key_file_set_string (key_file, group, "event-type", event_type);
+        g_key_file_set_boolean (key_file, group, "outgoing", outgoing);
+        g_key_file_set_integer (key_file, group, "flags", flags);
+
+        g_free (group);
+        g_free (text);
+        g_free (local_uid);
+        g_free (remote_uid);
+        g_free (remote_name);
+        g_free (econtact_uid);
+        g_free (service);
+        g_free (group_uid);
+        g_free (group_title);
+        g_free (event_type);
+        if (icon)
+            g_object_unref (icon);
+        if (service_icon)
+            g_object_unref (service_icon);
+        if (contact)
+            g_object_unref (contact);
+
+        n++;
+    }
+
+    return n;
+}
+
+guint
+rtcom_log_model_load_snapshot (
+        RTComLogModel * model,
+        GKeyFile * key_file)
+{
+    RTComLogModelPrivate *priv;
+    guint n;
+
+    g_return_val_if_fail (RTCOM_IS_LOG_MODEL (model), 0);
+    g_return_val_if_fail (key_file != NULL, 0);
+
+    priv = RTCOM_LOG_MODEL_GET_PRIV (model);
+
+    rtcom_log_model_clear (model);
+
+    g_signal_emit (model, bulk_insert_begin_signal_id, 0);
+
+    for (n = 0; ; n++)
+    {
+        GtkTreeIter iter;
+        GdkPixbuf * icon = NULL, * service_icon = NULL;
+        gchar * group, * str;
+        gchar * text, * remote_uid, * remote_name, * econtact_uid,
+              * group_uid, * group_title;
+        const gchar * local_uid, * service, * event_type;
+
+        group = g_strdup_printf ("row%u", n);
+        if (!g_key_file_has_group (key_file, group))
+        {
+            g_free (group);
+            break;
+        }
+
+        str = _key_file_get_string (key_file, group, "icon");
+        if (str)
+            icon = _lookup_icon (priv, str);
+        g_free (str);
+
+        str = _key_file_get_string (key_file, group, "service-icon");
+        if (str)
+            service_icon = _lookup_service_icon (priv, str);
+        g_free (str);
+
+        local_uid = _key_file_get_interned (key_file, group, "local-uid");
+        remote_uid = _key_file_get_string (key_file, group, "remote-uid");
+        service = _key_file_get_interned (key_file, group, "service");
+        event_type = _key_file_get_interned (key_file, group, "event-type");
+
+        text = _key_file_get_string (key_file, group, "text");
+        remote_name = _key_file_get_string (key_file, group, "remote-name");
+        econtact_uid = _key_file_get_string (key_file, group, "econtact-uid");
+        group_uid = _key_file_get_string (key_file, group, "group-uid");
+        group_title = _key_file_get_string (key_file, group, "group-title");
+
+        gtk_list_store_insert_with_values (
+                GTK_LIST_STORE (model),
+                &iter,
+                GTK_LIST_STORE (model)->length,
+                RTCOM_LOG_VIEW_COL_ICON, icon,
+                RTCOM_LOG_VIEW_COL_TEXT, text,
+                RTCOM_LOG_VIEW_COL_SERVICE_ICON, service_icon,
+                RTCOM_LOG_VIEW_COL_LOCAL_ACCOUNT, local_uid,
+                RTCOM_LOG_VIEW_COL_REMOTE_ACCOUNT, remote_uid,
+                RTCOM_LOG_VIEW_COL_REMOTE_NAME, remote_name,
+                RTCOM_LOG_VIEW_COL_ECONTACT_UID, econtact_uid,
+                RTCOM_LOG_VIEW_COL_EVENT_ID,
+                    g_key_file_get_integer (key_file, group, "event-id", NULL),
+                RTCOM_LOG_VIEW_COL_SERVICE, service,
+                RTCOM_LOG_VIEW_COL_GROUP_UID, group_uid,
+                RTCOM_LOG_VIEW_COL_TIMESTAMP,
+                    g_key_file_get_integer (key_file, group, "start-time", NULL),
+                RTCOM_LOG_VIEW_COL_END_TIMESTAMP,
+                    g_key_file_get_integer (key_file, group, "end-time", NULL),
+                RTCOM_LOG_VIEW_COL_COUNT,
+                    g_key_file_get_integer (key_file, group, "count", NULL),
+                RTCOM_LOG_VIEW_COL_GROUP_TITLE, group_title,
+                RTCOM_LOG_VIEW_COL_EVENT_TYPE, event_type,
+                RTCOM_LOG_VIEW_COL_OUTGOING,
+                    g_key_file_get_boolean (key_file, group, "outgoing", NULL),
+                RTCOM_LOG_VIEW_COL_FLAGS,
+                    g_key_file_get_integer (key_file, group, "flags", NULL),
+                -1);
+        _index_row (priv, &iter,
+                _row_event_id (GTK_TREE_MODEL (model), &iter));
+        _index_group (model, &iter);
+        if (local_uid && remote_uid)
+            _queue_resolve (model, &iter);
+
+        g_free (remote_uid);
+        g_free (text);
+        g_free (remote_name);
+        g_free (econtact_uid);
+        g_free (group_uid);
+        g_free (group_title);
+        g_free (group);
+    }
+
+    g_signal_emit (model, bulk_insert_end_signal_id, 0);
+
+    return n;
+}
 
 /* vim: set ai et tw=75 ts=4 sw=4: */
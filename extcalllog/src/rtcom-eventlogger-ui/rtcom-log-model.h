@@ -34,6 +34,8 @@
 #include <rtcom-eventlogger/eventlogger.h>
 #include <libosso-abook/osso-abook-aggregator.h>
 
+#include "rtcom-log-event-batch.h"
+
 G_BEGIN_DECLS
 
 #define RTCOM_LOG_MODEL_TYPE            (rtcom_log_model_get_type ())
@@ -72,6 +74,81 @@ RTComEl *
 rtcom_log_model_get_eventlogger(
         RTComLogModel * model);
 
+/**
+ * Deletes a set of events through the RTComEl of the model, and when the
+ * model isn't grouping, removes the rows of the deleted ones once all
+ * are deleted, without waiting for their event-deleted signals. Grouped
+ * rows are left to the signals, as the events left in a group decide
+ * what they show. Each event is deleted on its own, so a failure
+ * doesn't undo the deletions before it; the events that couldn't be
+ * deleted are added to @failed_ids and the rest are still tried.
+ * @param model The #RTComLogModel
+ * @param event_ids The ids of the events to delete
+ * @param n_event_ids The number of ids in event_ids
+ * @param failed_ids A #GArray of gint to append the ids of the events
+ * that couldn't be deleted to, or NULL
+ * @return the number of events deleted
+ */
+guint
+rtcom_log_model_delete_events(
+        RTComLogModel * model,
+        const gint * event_ids,
+        guint n_event_ids,
+        GArray * failed_ids);
+
+#define RTCOM_LOG_MODEL_ERROR (rtcom_log_model_error_quark ())
+
+/* The errors rtcom_log_model_delete_matching() reports. */
+typedef enum
+{
+    /* The events to delete couldn't all be read, so none was deleted */
+    RTCOM_LOG_MODEL_ERROR_READ,
+    /* Some of the events couldn't be deleted */
+    RTCOM_LOG_MODEL_ERROR_DELETE
+} RTComLogModelError;
+
+GQuark
+rtcom_log_model_error_quark (void);
+
+/**
+ * Reports the progress of rtcom_log_model_delete_matching(), on the main
+ * loop. The rows of the deleted events are gone by the time it's called.
+ * @param model The #RTComLogModel
+ * @param deleted How many events were deleted so far
+ * @param total How many events match, 0 while they're still being
+ * collected
+ * @param done TRUE for the last report
+ * @param error With done, what went wrong if not every event was
+ * deleted, in the #RTCOM_LOG_MODEL_ERROR domain; NULL otherwise
+ * @param data The user data passed to rtcom_log_model_delete_matching()
+ */
+typedef void (*RTComLogModelDeleteFunc) (
+        RTComLogModel * model,
+        guint deleted,
+        guint total,
+        gboolean done,
+        const GError * error,
+        gpointer data);
+
+/**
+ * Deletes every event the query func the model was last populated with
+ * selects, loaded or not and whatever the limit, from a thread of its
+ * own with an RTComEl of its own. The ids are collected first, so events
+ * arriving meanwhile are kept, and if they can't all be read nothing is
+ * deleted. Disposing the model stops the deletion after the current
+ * event.
+ * @param model The #RTComLogModel
+ * @param func Function reporting the progress, or NULL
+ * @param data User data for @func
+ * @return TRUE if the deletion started, FALSE if the model has no query
+ * func or is already deleting
+ */
+gboolean
+rtcom_log_model_delete_matching(
+        RTComLogModel * model,
+        RTComLogModelDeleteFunc func,
+        gpointer data);
+
 /**
  * Populates the model with all the events in the database.
  * @param model The #RTComLogModel
@@ -97,9 +174,92 @@ rtcom_log_model_populate_query(
         RTComLogModel *model,
         RTComElQuery *query);
 
+/**
+ * Prepares @query to select the events the model should show, restricted
+ * to events whose id is lower than @before_id. The model calls it once
+ * with G_MAXINT for the first page and then again from its caching
+ * thread with the id of the oldest event loaded so far, so it must not
+ * touch any UI state.
+ * @param query The #RTComElQuery to prepare
+ * @param before_id Only events with a lower id should be selected
+ * @param data The user data passed to rtcom_log_model_populate_query_func()
+ * @return TRUE if the query could be prepared
+ */
+typedef gboolean (*RTComLogModelQueryFunc) (
+        RTComElQuery * query,
+        gint before_id,
+        gpointer data);
+
+/**
+ * Populates the model with events selected by @func. Unlike
+ * rtcom_log_model_populate_query(), the model pages through the results
+ * by asking @func for the events older than the last one loaded, rather
+ * than by offset, so loading a long history takes linear time and new
+ * events arriving meanwhile don't shift the pages.
+ *
+ * Populating again or clearing the model doesn't wait for the caching
+ * thread, which may go on calling @func with @data until it notices; so
+ * @data is only destroyed once no thread uses it.
+ * @param model The #RTComLogModel
+ * @param func The #RTComLogModelQueryFunc preparing the queries
+ * @param data User data for @func
+ * @param destroy Function freeing @data once the model doesn't need it
+ */
+void
+rtcom_log_model_populate_query_func(
+        RTComLogModel * model,
+        RTComLogModelQueryFunc func,
+        gpointer data,
+        GDestroyNotify destroy);
+
+/**
+ * Reads the events a #RTComLogModelQueryFunc would select straight into
+ * a batch, bypassing the event logger. May be called from the model's
+ * caching thread, or the one of rtcom_log_model_delete_matching().
+ * @param batch The #RTComLogEventBatch to append the events to
+ * @param before_id Only events with a smaller id have to be read
+ * @param limit Maximum number of events to read
+ * @param data The user data passed to rtcom_log_model_populate_query_func()
+ * @return TRUE on success, FALSE to have the model read the events
+ * through the event logger instead
+ */
+typedef gboolean (*RTComLogModelReadFunc) (
+        RTComLogEventBatch * batch,
+        gint before_id,
+        gint limit,
+        gpointer data);
+
+/**
+ * Tells the model which rows the view shows, so the contacts of those
+ * are resolved before the others. The view calls it whenever it draws.
+ * @param model The #RTComLogModel
+ * @param first The path of the first visible row, or NULL if none is
+ * @param last The path of the last visible row, or NULL if none is
+ */
+void
+rtcom_log_model_set_visible_range(
+        RTComLogModel * model,
+        GtkTreePath * first,
+        GtkTreePath * last);
+
+/**
+ * Sets a function reading the pages of ungrouped queries populated with
+ * rtcom_log_model_populate_query_func() directly, instead of through
+ * the event logger. The query func still prepares the model's own
+ * query. Takes effect on the next populate or refresh.
+ * @param model The #RTComLogModel
+ * @param func The #RTComLogModelReadFunc, or NULL to read through the
+ * event logger
+ */
+void
+rtcom_log_model_set_read_func(
+        RTComLogModel * model,
+        RTComLogModelReadFunc func);
+
 /*
  * Sets the default limit of results to be returned. This will be
- * used for all subsequent queries.
+ * used for all subsequent queries. The rows already past the new limit
+ * are removed from the end of the list.
  * @param model The #RTComLogModel
  * @param limit Result limit or -1 for unlimited number of results
  */
@@ -109,7 +269,9 @@ rtcom_log_model_set_limit(
         gint limit);
 
 /**
- * Refreshed the model, i.e. reloads the events from the db.
+ * Refreshed the model, i.e. reloads the events from the db. A short list
+ * that is fully loaded is updated in place, so the rows that didn't
+ * change aren't removed and inserted again.
  * @param model The #RTComLogModel
  */
 void
@@ -173,6 +335,123 @@ rtcom_log_model_set_show_group_chat (
         RTComLogModel * model,
         gboolean is_shown);
 
+/**
+ * Sets whether unlimited results (see rtcom_log_model_set_limit())
+ * populated through rtcom_log_model_populate() or
+ * rtcom_log_model_populate_query_func() are loaded lazily. The model
+ * still has a row for every event, so it knows the total count, but
+ * past the first page it reads the values of a row from the database
+ * only when asked for them, and keeps a bounded number of such pages
+ * in memory. Takes effect on the next populate or refresh. Default
+ * value is TRUE.
+ * @param model The #RTComLogModel
+ * @param lazy Whether to load unlimited results lazily
+ */
+void
+rtcom_log_model_set_lazy_loading (
+        RTComLogModel * model,
+        gboolean lazy);
+
+/**
+ * Tells the model whether a search filter is reading every row, e.g. a
+ * #GtkTreeModelFilter with a visible function matching some text.
+ * While searching, the lazily loaded rows are replaced with full ones in
+ * the background, and until then read as empty, rather than being read
+ * from the database a page at a time as the filter goes through them.
+ * Rows staged while searching are full ones from the start.
+ * @param model The #RTComLogModel
+ * @param searching Whether a search is going on
+ */
+void
+rtcom_log_model_set_searching (
+        RTComLogModel * model,
+        gboolean searching);
+
+/**
+ * Gets how fast the rows of the current load were staged into the
+ * model, and the longest time a single staging pass held the main loop.
+ * Meant for debugging the loading performance.
+ * @param model The #RTComLogModel
+ * @param rows_per_second Return location for the staged rows per second,
+ * or NULL
+ * @param longest_stall_ms Return location for the longest stall in
+ * milliseconds, or NULL
+ */
+void
+rtcom_log_model_get_staging_stats (
+        RTComLogModel * model,
+        gdouble * rows_per_second,
+        gdouble * longest_stall_ms);
+
+/**
+ * Gets how often looking up the contact of a remote uid was answered by
+ * the cache of the remote uids known not to be contacts, and how often
+ * the address book had to be searched. Meant for debugging the loading
+ * performance.
+ * @param model The #RTComLogModel
+ * @param hits Return location for the lookups answered by the cache, or
+ * NULL
+ * @param misses Return location for the lookups searching the address
+ * book, or NULL
+ */
+void
+rtcom_log_model_get_discovery_stats (
+        RTComLogModel * model,
+        guint * hits,
+        guint * misses);
+
+/**
+ * Gets the state of the queue between the caching thread and the main
+ * loop for the current load. Meant for debugging the loading
+ * performance.
+ * @param model The #RTComLogModel
+ * @param queue_depth Return location for the number of batches waiting
+ * to be staged, or NULL
+ * @param max_queue_depth Return location for the deepest the queue got,
+ * or NULL
+ * @param read_ms Return location for the average time reading a batch
+ * took on the caching thread, in milliseconds, or NULL
+ * @param queue_wait_ms Return location for the average time a batch
+ * waited in the queue before staging started on it, in milliseconds, or
+ * NULL
+ */
+void
+rtcom_log_model_get_pipeline_stats (
+        RTComLogModel * model,
+        guint * queue_depth,
+        guint * max_queue_depth,
+        gdouble * read_ms,
+        gdouble * queue_wait_ms);
+
+/**
+ * Writes the first rows of the model to @key_file, one "row<n>" group
+ * per row, so rtcom_log_model_load_snapshot() can show them on the next
+ * start before anything is read from the event logger. Icons are saved
+ * by name and contacts by the name they show.
+ * @param model The #RTComLogModel
+ * @param key_file The #GKeyFile to write to
+ * @param n_rows How many rows to save at most
+ * @return the number of rows saved
+ */
+guint
+rtcom_log_model_save_snapshot (
+        RTComLogModel * model,
+        GKeyFile * key_file,
+        guint n_rows);
+
+/**
+ * Clears the model and fills it with the rows written to @key_file by
+ * rtcom_log_model_save_snapshot(). The rows have no contacts attached;
+ * populating the model replaces them with the real ones.
+ * @param model The #RTComLogModel
+ * @param key_file The #GKeyFile to read
+ * @return the number of rows loaded
+ */
+guint
+rtcom_log_model_load_snapshot (
+        RTComLogModel * model,
+        GKeyFile * key_file);
+
 G_END_DECLS
 
 #endif
@@ -0,0 +1,348 @@
+/* This file is part of Extended Call Log
+ *
+ * Copyright (C) 2010 Thom Troy
+ *
+ * WebTexter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License (GPL) as published by
+ * the Free Software Foundation
+ *
+ * WebTexter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Extended Call Log. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "rtcom-log-phone-index.h"
+
+#include <string.h>
+#include <libebook/e-contact.h>
+#include <libebook/e-vcard.h>
+
+/* Country codes have one to three digits */
+#define PHONE_COUNTRY_CODE_DIGITS 3
+
+/* A phone number of a contact. Owned by the by_contact list of the
+ * contact, by_key only points to it. */
+typedef struct _phone_entry phone_entry_t;
+struct _phone_entry
+{
+    gchar * digits;
+    gchar * uid;
+    gchar * persistent_uid;
+};
+
+struct _RTComLogPhoneIndex
+{
+    /* The last digits of the numbers to the GSList of their entries */
+    GHashTable * by_key;
+    /* Contact uid to the GSList of the entries of its numbers */
+    GHashTable * by_contact;
+};
+
+/* Keeps the digits of the number. An international "00" prefix is
+ * written "+", like a leading "+", and the national trunk "0" is
+ * dropped, so the same number is either "+" and the country code
+ * followed by the national number, or the national number alone.
+ * Returns NULL for what isn't a phone number, or has no digits. */
+static gchar *
+_phone_digits (const gchar * number)
+{
+    GString * digits;
+    const gchar * p;
+    gboolean international = FALSE;
+
+    if (!number)
+        return NULL;
+
+    digits = g_string_sized_new (strlen (number) + 1);
+
+    for (p = number; *p; p++)
+    {
+        if (g_ascii_isdigit (*p) || *p == '*' || *p == '#')
+            g_string_append_c (digits, *p);
+        else if (*p == '+' && digits->len == 0)
+            international = TRUE;
+        /* The pauses and the tones dialled after them */
+        else if (*p == 'p' || *p == 'P' || *p == 'w' || *p == 'W' ||
+                *p == ',' || *p == ';')
+            break;
+        /* SIP and IM addresses */
+        else if (g_ascii_isalpha (*p) || *p == '@')
+        {
+            g_string_free (digits, TRUE);
+            return NULL;
+        }
+    }
+
+    if (!international && g_str_has_prefix (digits->str, "00"))
+    {
+        g_string_erase (digits, 0, 2);
+        international = TRUE;
+    }
+    else if (!international && digits->str[0] == '0')
+        g_string_erase (digits, 0, 1);
+
+    if (digits->len == 0)
+    {
+        g_string_free (digits, TRUE);
+        return NULL;
+    }
+
+    if (international)
+        g_string_prepend_c (digits, '+');
+
+    return g_string_free (digits, FALSE);
+}
+
+static const gchar *
+_phone_key (const gchar * digits)
+{
+    gsize len = strlen (digits);
+
+    if (len <= RTCOM_LOG_PHONE_INDEX_KEY_DIGITS)
+        return digits;
+    return digits + len - RTCOM_LOG_PHONE_INDEX_KEY_DIGITS;
+}
+
+/* Whether two numbers sharing a key are the same number. Numbers
+ * written the same way have to be equal; otherwise the international
+ * one has to be a country code followed by the national one, which
+ * has at least RTCOM_LOG_PHONE_INDEX_MIN_DIGITS digits. Any other
+ * leading digits, like an area code one of the numbers was saved
+ * without, make them different numbers. */
+static gboolean
+_phone_digits_match (const gchar * a, const gchar * b)
+{
+    const gchar * international, * national;
+    gsize international_len, national_len;
+
+    if ((a[0] == '+') == (b[0] == '+'))
+        return strcmp (a, b) == 0;
+
+    international = a[0] == '+' ? a + 1 : b + 1;
+    national = a[0] == '+' ? b : a;
+    international_len = strlen (international);
+    national_len = strlen (national);
+
+    if (national_len < RTCOM_LOG_PHONE_INDEX_MIN_DIGITS ||
+        international_len <= national_len ||
+        international_len - national_len > PHONE_COUNTRY_CODE_DIGITS)
+        return FALSE;
+
+    return strcmp (international + international_len - national_len,
+            national) == 0;
+}
+
+static void
+_phone_entry_free (phone_entry_t * entry)
+{
+    g_free (entry->digits);
+    g_free (entry->uid);
+    g_free (entry->persistent_uid);
+    g_slice_free (phone_entry_t, entry);
+}
+
+static void
+_phone_entries_free (GSList * entries)
+{
+    g_slist_foreach (entries, (GFunc) _phone_entry_free, NULL);
+    g_slist_free (entries);
+}
+
+RTComLogPhoneIndex *
+rtcom_log_phone_index_new(void)
+{
+    RTComLogPhoneIndex * index = g_slice_new0(RTComLogPhoneIndex);
+
+    /* The keys point into the digits of the entries */
+    index->by_key = g_hash_table_new_full(g_str_hash, g_str_equal,
+            NULL, (GDestroyNotify) g_slist_free);
+    index->by_contact = g_hash_table_new_full(g_str_hash, g_str_equal,
+            g_free, (GDestroyNotify) _phone_entries_free);
+
+    return index;
+}
+
+void
+rtcom_log_phone_index_free(
+        RTComLogPhoneIndex * index)
+{
+    if (!index)
+        return;
+
+    g_hash_table_destroy(index->by_key);
+    g_hash_table_destroy(index->by_contact);
+    g_slice_free(RTComLogPhoneIndex, index);
+}
+
+void
+rtcom_log_phone_index_remove_contact(
+        RTComLogPhoneIndex * index,
+        const gchar * uid)
+{
+    GSList * entries, * l;
+
+    g_return_if_fail(index != NULL);
+
+    if (!uid)
+        return;
+
+    entries = g_hash_table_lookup(index->by_contact, uid);
+
+    for (l = entries; l; l = l->next)
+    {
+        phone_entry_t * entry = l->data;
+        const gchar * key = _phone_key(entry->digits);
+        GSList * same_key = g_hash_table_lookup(index->by_key, key);
+
+        same_key = g_slist_remove(same_key, entry);
+
+        /* The table key may be this entry's digits, so replace it
+         * along with the list. */
+        g_hash_table_steal(index->by_key, key);
+        if (same_key)
+            g_hash_table_insert(index->by_key,
+                    (gpointer) _phone_key(
+                        ((phone_entry_t *) same_key->data)->digits),
+                    same_key);
+    }
+
+    g_hash_table_remove(index->by_contact, uid);
+}
+
+void
+rtcom_log_phone_index_add_contact(
+        RTComLogPhoneIndex * index,
+        OssoABookContact * contact)
+{
+    const gchar * uid;
+    const gchar * persistent_uid;
+    GSList * entries = NULL;
+    GList * attrs;
+
+    g_return_if_fail(index != NULL);
+    g_return_if_fail(OSSO_ABOOK_IS_CONTACT(contact));
+
+    uid = e_contact_get_const(E_CONTACT(contact), E_CONTACT_UID);
+    if (!uid)
+        return;
+
+    rtcom_log_phone_index_remove_contact(index, uid);
+
+    persistent_uid = osso_abook_contact_get_persistent_uid(contact);
+
+    for (attrs = e_vcard_get_attributes(E_VCARD(contact)); attrs;
+         attrs = attrs->next)
+    {
+        EVCardAttribute * attr = attrs->data;
+        phone_entry_t * entry;
+        const gchar * key;
+        gchar * value, * digits;
+        GSList * same_key;
+
+        if (strcmp(e_vcard_attribute_get_name(attr), EVC_TEL) != 0)
+            continue;
+
+        value = e_vcard_attribute_get_value(attr);
+        digits = _phone_digits(value);
+        g_free(value);
+
+        if (!digits)
+            continue;
+
+        entry = g_slice_new(phone_entry_t);
+        entry->digits = digits;
+        entry->uid = g_strdup(uid);
+        entry->persistent_uid = g_strdup(persistent_uid);
+        entries = g_slist_prepend(entries, entry);
+
+        key = _phone_key(digits);
+        same_key = g_hash_table_lookup(index->by_key, key);
+        g_hash_table_steal(index->by_key, key);
+        g_hash_table_insert(index->by_key, (gpointer) key,
+                g_slist_prepend(same_key, entry));
+    }
+
+    if (entries)
+        g_hash_table_insert(index->by_contact, g_strdup(uid), entries);
+}
+
+const gchar *
+rtcom_log_phone_index_lookup(
+        RTComLogPhoneIndex * index,
+        const gchar * phone_number)
+{
+    const phone_entry_t * found = NULL;
+    gchar * digits;
+    GSList * l;
+
+    g_return_val_if_fail(index != NULL, NULL);
+
+    digits = _phone_digits(phone_number);
+    if (!digits)
+        return NULL;
+
+    for (l = g_hash_table_lookup(index->by_key, _phone_key(digits)); l;
+         l = l->next)
+    {
+        const phone_entry_t * entry = l->data;
+
+        if (!_phone_digits_match(digits, entry->digits))
+            continue;
+
+        /* Like the aggregator, only match a single contact */
+        if (found && strcmp(found->uid, entry->uid) != 0)
+        {
+            found = NULL;
+            break;
+        }
+        found = entry;
+    }
+
+    g_free(digits);
+
+    return found ? found->persistent_uid : NULL;
+}
+
+gchar *
+rtcom_log_phone_index_number_key(
+        const gchar * phone_number)
+{
+    gchar * digits = _phone_digits(phone_number);
+    gchar * key;
+
+    if (!digits)
+        return NULL;
+
+    key = g_strdup(_phone_key(digits));
+    g_free(digits);
+
+    return key;
+}
+
+void
+rtcom_log_phone_index_contact_keys(
+        RTComLogPhoneIndex * index,
+        const gchar * uid,
+        GHashTable * keys)
+{
+    GSList * l;
+
+    g_return_if_fail(index != NULL);
+
+    if (!uid)
+        return;
+
+    for (l = g_hash_table_lookup(index->by_contact, uid); l; l = l->next)
+    {
+        gchar * key = g_strdup(
+                _phone_key(((phone_entry_t *) l->data)->digits));
+
+        g_hash_table_replace(keys, key, key);
+    }
+}
+
+/* vim: set ai et tw=75 ts=4 sw=4: */
@@ -0,0 +1,130 @@
+/* This file is part of Extended Call Log
+ *
+ * Copyright (C) 2010 Thom Troy
+ *
+ * WebTexter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License (GPL) as published by
+ * the Free Software Foundation
+ *
+ * WebTexter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Extended Call Log. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file rtcom-log-phone-index.h
+ * @brief Finds the contact owning a phone number with a hash lookup.
+ *
+ * Asking the aggregator for the contacts of a phone number compares the
+ * number with every number in the address book, and the model asks for
+ * every row without a contact. The index keeps the numbers of all the
+ * contacts by their last digits instead, so a lookup only compares the
+ * handful of numbers ending the same way.
+ *
+ * Numbers are compared without their separators: "+353 87 123 4567",
+ * "00353871234567" and "087-1234567" are the same number, but
+ * "1234567", lacking the area code, isn't. A number saved without its
+ * country code only matches numbers with a one to three digit country
+ * code in front of it, and then only if it has at least
+ * RTCOM_LOG_PHONE_INDEX_MIN_DIGITS digits; shorter numbers, like short
+ * codes, only match exactly.
+ */
+
+#ifndef __RTCOM_LOG_PHONE_INDEX_H
+#define __RTCOM_LOG_PHONE_INDEX_H
+
+#include <glib.h>
+#include <libosso-abook/osso-abook-contact.h>
+
+G_BEGIN_DECLS
+
+/* How many of the last digits two numbers have to share to be compared */
+#define RTCOM_LOG_PHONE_INDEX_KEY_DIGITS 7
+
+/* How many digits a number without a country code needs to match one
+ * with it */
+#define RTCOM_LOG_PHONE_INDEX_MIN_DIGITS 7
+
+typedef struct _RTComLogPhoneIndex RTComLogPhoneIndex;
+
+/**
+ * Creates an empty index.
+ * @return a new #RTComLogPhoneIndex
+ */
+RTComLogPhoneIndex *
+rtcom_log_phone_index_new(void);
+
+/**
+ * Frees the index.
+ * @param index The #RTComLogPhoneIndex
+ */
+void
+rtcom_log_phone_index_free(
+        RTComLogPhoneIndex * index);
+
+/**
+ * Adds the phone numbers of a contact to the index, replacing the ones
+ * it had if the contact is in already.
+ * @param index The #RTComLogPhoneIndex
+ * @param contact The #OssoABookContact
+ */
+void
+rtcom_log_phone_index_add_contact(
+        RTComLogPhoneIndex * index,
+        OssoABookContact * contact);
+
+/**
+ * Removes the phone numbers of a contact from the index.
+ * @param index The #RTComLogPhoneIndex
+ * @param uid The uid of the contact
+ */
+void
+rtcom_log_phone_index_remove_contact(
+        RTComLogPhoneIndex * index,
+        const gchar * uid);
+
+/**
+ * Finds the contact having the phone number.
+ * @param index The #RTComLogPhoneIndex
+ * @param phone_number The number to look for
+ * @return the persistent uid of the contact, owned by the index, or NULL
+ * if no contact or more than one has the number
+ */
+const gchar *
+rtcom_log_phone_index_lookup(
+        RTComLogPhoneIndex * index,
+        const gchar * phone_number);
+
+/**
+ * Gives the key the index files a phone number under, which the
+ * numbers that may match it share.
+ * @param phone_number The number
+ * @return the newly allocated key, or NULL if the number isn't a phone
+ * number
+ */
+gchar *
+rtcom_log_phone_index_number_key(
+        const gchar * phone_number);
+
+/**
+ * Adds the keys of the phone numbers of a contact in the index to a
+ * set, as newly allocated strings mapping to themselves.
+ * @param index The #RTComLogPhoneIndex
+ * @param uid The uid of the contact
+ * @param keys The #GHashTable to add the keys to, freeing its keys
+ */
+void
+rtcom_log_phone_index_contact_keys(
+        RTComLogPhoneIndex * index,
+        const gchar * uid,
+        GHashTable * keys);
+
+G_END_DECLS
+
+#endif
+
+/* vim: set ai et tw=75 ts=4 sw=4: */
@@ -120,6 +120,7 @@ _visible_func(
     glong len = 0;
     gssize size;
     gchar * displayed_name;
+    gchar * remote_uid = NULL;
     gboolean result = FALSE;
     gchar * haystack;
     gchar * haypart;
@@ -140,11 +141,17 @@ _visible_func(
 
     if (!displayed_name)
         gtk_tree_model_get (model, iter, RTCOM_LOG_VIEW_COL_REMOTE_ACCOUNT,
-            &displayed_name, -1);
+            &remote_uid, -1);
+
+    /* A lazily loaded row the model hasn't read yet */
+    if (!displayed_name && !remote_uid)
+        return FALSE;
 
     needle = g_utf8_strdown(text, -1);
-    haystack = g_utf8_strdown(displayed_name, -1);
+    haystack = g_utf8_strdown(
+            displayed_name ? displayed_name : remote_uid, -1);
     g_free (displayed_name);
+    g_free (remote_uid);
 
     /*tokenizing needle*/
     for (needle_part = needle;
@@ -398,6 +405,12 @@ _entry_changed_cb(
     g_return_if_fail(RTCOM_IS_LOG_SEARCH_BAR(sb));
 
     priv = RTCOM_LOG_SEARCH_BAR_GET_PRIVATE(sb);
+
+    /* The filter is about to read every row */
+    if (priv->model)
+        rtcom_log_model_set_searching (priv->model,
+            *gtk_entry_get_text (entry) != '\0');
+
     gtk_tree_model_filter_refilter(
             GTK_TREE_MODEL_FILTER(priv->model_filter));
 }
@@ -416,6 +429,7 @@ rtcom_log_search_bar_dispose(
     if(priv->model)
     {
         g_debug(G_STRLOC ": unreffing the model...");
+        rtcom_log_model_set_searching(priv->model, FALSE);
         g_object_unref(priv->model);
         priv->model = NULL;
     }
@@ -554,6 +568,7 @@ rtcom_log_search_bar_set_model(
 
     if (priv->model)
     {
+        rtcom_log_model_set_searching (priv->model, FALSE);
         g_object_unref (priv->model);
         priv->model = NULL;
     }
@@ -570,6 +585,9 @@ rtcom_log_search_bar_set_model(
                 _visible_func,
                 priv,
                 NULL);
+
+        rtcom_log_model_set_searching (priv->model,
+            *gtk_entry_get_text (GTK_ENTRY (priv->entry)) != '\0');
     }
 }
 
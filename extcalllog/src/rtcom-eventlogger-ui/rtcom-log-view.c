@@ -79,9 +79,11 @@ struct _RTComLogViewPrivate
     gulong before_row_inserted_handler;
     gulong after_row_inserted_handler;
     gulong row_changed_handler;
-    gulong row_deleted_handler;
     gulong presence_need_redraw_handler;
     gulong avatar_need_redraw_handler;
+    gulong bulk_insert_begin_handler;
+    gulong bulk_insert_end_handler;
+    GObject * bulk_insert_model;
     gboolean needs_adjustment;
 
     struct _cell_data presence_cell;
@@ -322,6 +324,49 @@ size_allocate_cb (GtkWidget *view, GtkAllocation *allocation,
   }
 }
 
+/* Has our model resolve the contacts of the rows being drawn first */
+static gboolean
+expose_event_cb (GtkWidget *view, GdkEventExpose *event,
+    gpointer user_data)
+{
+  RTComLogViewPrivate * priv = RTCOM_LOG_VIEW_GET_PRIV(view);
+  GtkTreePath *first = NULL, *last = NULL;
+  GtkTreePath *child_first = NULL, *child_last = NULL;
+  GtkTreeModel *model = priv->model;
+
+  if (model == NULL || priv->bulk_insert_model == NULL ||
+      !RTCOM_IS_LOG_MODEL (priv->bulk_insert_model))
+      return FALSE;
+
+  if (gtk_tree_view_get_visible_range (GTK_TREE_VIEW (view), &first, &last))
+  {
+      if (GTK_IS_TREE_MODEL_FILTER (model))
+      {
+          child_first = gtk_tree_model_filter_convert_path_to_child_path
+              (GTK_TREE_MODEL_FILTER (model), first);
+          child_last = gtk_tree_model_filter_convert_path_to_child_path
+              (GTK_TREE_MODEL_FILTER (model), last);
+          gtk_tree_path_free (first);
+          gtk_tree_path_free (last);
+      }
+      else
+      {
+          child_first = first;
+          child_last = last;
+      }
+  }
+
+  rtcom_log_model_set_visible_range
+      (RTCOM_LOG_MODEL (priv->bulk_insert_model), child_first, child_last);
+
+  if (child_first)
+      gtk_tree_path_free (child_first);
+  if (child_last)
+      gtk_tree_path_free (child_last);
+
+  return FALSE;
+}
+
 static void
 rtcom_log_view_init(
         RTComLogView * log_view)
@@ -437,6 +482,8 @@ rtcom_log_view_init(
 
     g_signal_connect (G_OBJECT (log_view), "size-allocate",
       (GCallback) size_allocate_cb, NULL);
+    g_signal_connect (G_OBJECT (log_view), "expose-event",
+      (GCallback) expose_event_cb, NULL);
 
     _init_settings(log_view);
 }
@@ -483,20 +530,14 @@ _row_changed_cb(
 {
     RTComLogView * view = RTCOM_LOG_VIEW(data);
     RTComLogViewPrivate * priv = RTCOM_LOG_VIEW_GET_PRIV(view);
+    gint event_id = 0;
 
-    g_hash_table_remove_all (priv->text_cell_cache);
-}
-
-static void
-_row_deleted_cb(
-        GtkTreeModel * model,
-        GtkTreePath  * path,
-        gpointer       data)
-{
-    RTComLogView * view = RTCOM_LOG_VIEW(data);
-    RTComLogViewPrivate * priv = RTCOM_LOG_VIEW_GET_PRIV(view);
+    /* Only the markup of the changed row is stale. */
+    gtk_tree_model_get (model, iter,
+            RTCOM_LOG_VIEW_COL_EVENT_ID, &event_id,
+            -1);
 
-    g_hash_table_remove_all (priv->text_cell_cache);
+    g_hash_table_remove (priv->text_cell_cache, GUINT_TO_POINTER (event_id));
 }
 
 static void
@@ -540,6 +581,40 @@ _after_row_inserted(
     }
 }
 
+/* While the model stages a batch of rows, the per-row insert handlers
+ * are blocked and the adjustment is checked once for the whole batch. */
+static void
+_bulk_insert_begin(
+        GtkTreeModel * model,
+        gpointer view)
+{
+    RTComLogViewPrivate * priv = RTCOM_LOG_VIEW_GET_PRIV(RTCOM_LOG_VIEW(view));
+
+    if(priv->model == NULL)
+        return;
+
+    _before_row_inserted(priv->model, NULL, NULL, view);
+
+    g_signal_handler_block(priv->model, priv->before_row_inserted_handler);
+    g_signal_handler_block(priv->model, priv->after_row_inserted_handler);
+}
+
+static void
+_bulk_insert_end(
+        GtkTreeModel * model,
+        gpointer view)
+{
+    RTComLogViewPrivate * priv = RTCOM_LOG_VIEW_GET_PRIV(RTCOM_LOG_VIEW(view));
+
+    if(priv->model == NULL)
+        return;
+
+    g_signal_handler_unblock(priv->model, priv->before_row_inserted_handler);
+    g_signal_handler_unblock(priv->model, priv->after_row_inserted_handler);
+
+    _after_row_inserted(priv->model, NULL, NULL, view);
+}
+
 static void
 _presence_need_redraw(
         GtkTreeModel * model,
@@ -638,17 +713,14 @@ rtcom_log_view_set_model(
                         G_OBJECT(model),
                         priv->row_changed_handler))
             {
-                g_debug("Connecting row-changed and row-deleted...");
+                /* The markup cache is keyed by event id, so the rows
+                 * deleted only leave entries nothing asks for. */
+                g_debug("Connecting row-changed...");
                 priv->row_changed_handler = g_signal_connect_after(
                         G_OBJECT(model),
                         "row-changed",
                         (GCallback) _row_changed_cb,
                         view);
-                priv->row_deleted_handler = g_signal_connect(
-                        G_OBJECT(model),
-                        "row-deleted",
-                        (GCallback) _row_deleted_cb,
-                        view);
             }
 
             if(child_model)
@@ -677,6 +749,28 @@ rtcom_log_view_set_model(
                             view);
                 }
             }
+
+            /* Only our own model batches its inserts. */
+            priv->bulk_insert_model = G_OBJECT(child_model ? child_model : model);
+            if(g_signal_lookup("bulk-insert-begin",
+                        G_OBJECT_TYPE(priv->bulk_insert_model)) != 0)
+            {
+                g_debug("Connecting bulk-insert-begin and bulk-insert-end...");
+                priv->bulk_insert_begin_handler = g_signal_connect(
+                        priv->bulk_insert_model,
+                        "bulk-insert-begin",
+                        (GCallback) _bulk_insert_begin,
+                        view);
+                priv->bulk_insert_end_handler = g_signal_connect(
+                        priv->bulk_insert_model,
+                        "bulk-insert-end",
+                        (GCallback) _bulk_insert_end,
+                        view);
+            }
+            else
+            {
+                priv->bulk_insert_model = NULL;
+            }
         }
 
         priv->model = model;
@@ -1139,12 +1233,6 @@ _destroy_old_model (
                 priv->model, priv->row_changed_handler);
             priv->row_changed_handler = 0;
         }
-        if (priv->row_deleted_handler != 0)
-        {
-            g_signal_handler_disconnect (
-                priv->model, priv->row_deleted_handler);
-            priv->row_deleted_handler = 0;
-        }
 
         if (filter_model != NULL &&
             priv->presence_need_redraw_handler != 0)
@@ -1162,6 +1250,17 @@ _destroy_old_model (
             priv->avatar_need_redraw_handler = 0;
         }
 
+        if (priv->bulk_insert_model != NULL)
+        {
+            g_signal_handler_disconnect (
+                priv->bulk_insert_model, priv->bulk_insert_begin_handler);
+            g_signal_handler_disconnect (
+                priv->bulk_insert_model, priv->bulk_insert_end_handler);
+            priv->bulk_insert_begin_handler = 0;
+            priv->bulk_insert_end_handler = 0;
+            priv->bulk_insert_model = NULL;
+        }
+
         g_debug("Unreffing the previous model..");
         g_object_unref(priv->model);
 
@@ -1235,4 +1334,65 @@ rtcom_log_view_set_show_display_names (
     g_hash_table_remove_all (priv->text_cell_cache);
 }
 
+void
+rtcom_log_view_set_multi_select (
+        RTComLogView *view,
+        gboolean multi_select)
+{
+    GtkTreeSelection *selection;
+
+    g_return_if_fail (RTCOM_IS_LOG_VIEW (view));
+
+    selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (view));
+
+    if (multi_select)
+    {
+        hildon_gtk_tree_view_set_ui_mode (GTK_TREE_VIEW (view),
+            HILDON_UI_MODE_EDIT);
+        gtk_tree_selection_set_mode (selection, GTK_SELECTION_MULTIPLE);
+        gtk_tree_selection_unselect_all (selection);
+    }
+    else
+    {
+        /* Setting the normal mode drops the selection as well. */
+        hildon_gtk_tree_view_set_ui_mode (GTK_TREE_VIEW (view),
+            HILDON_UI_MODE_NORMAL);
+    }
+}
+
+static void
+_collect_event_id (
+        GtkTreeModel *model,
+        GtkTreePath *path,
+        GtkTreeIter *iter,
+        gpointer data)
+{
+    gint event_id = 0;
+
+    gtk_tree_model_get (model, iter,
+            RTCOM_LOG_VIEW_COL_EVENT_ID, &event_id,
+            -1);
+
+    g_array_append_val ((GArray *) data, event_id);
+}
+
+GArray *
+rtcom_log_view_get_selected_event_ids (
+        RTComLogView *view)
+{
+    GtkTreeSelection *selection;
+    GArray *ids;
+
+    g_return_val_if_fail (RTCOM_IS_LOG_VIEW (view), NULL);
+
+    selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (view));
+    ids = g_array_sized_new (FALSE, FALSE, sizeof (gint),
+        gtk_tree_selection_count_selected_rows (selection));
+
+    /* Goes through the filter, if any, so the ids are the model's. */
+    gtk_tree_selection_selected_foreach (selection, _collect_event_id, ids);
+
+    return ids;
+}
+
 /* vim: set ai et tw=75 ts=4 sw=4: */
@@ -123,6 +123,27 @@ rtcom_log_view_set_show_display_names (
         RTComLogView * view,
         gboolean show_display_names);
 
+/**
+ * Switches the view to the edit mode, where tapping rows selects
+ * several of them instead of activating them, and back.
+ * @param view The #RTComLogView
+ * @param multi_select TRUE for the edit mode
+ */
+void
+rtcom_log_view_set_multi_select (
+        RTComLogView * view,
+        gboolean multi_select);
+
+/**
+ * Gets the event ids of the selected rows, for instance to pass them to
+ * rtcom_log_model_delete_events().
+ * @param view The #RTComLogView
+ * @return a newly allocated #GArray of gint, free it with g_array_free()
+ */
+GArray *
+rtcom_log_view_get_selected_event_ids (
+        RTComLogView * view);
+
 G_END_DECLS
 
 #endif
@@ -109,4 +109,29 @@ gint get_default_type()
 
 }
 
+gboolean set_direct_db(gboolean direct_db)
+{
+	/* Get the default client */
+	GConfClient *client = gconf_client_get_default();
+
+	gconf_client_add_dir (client, "/apps/extcalllog",
+	                GCONF_CLIENT_PRELOAD_NONE, NULL);
+
+	return gconf_client_set_bool (client,
+			"/apps/extcalllog/direct_db",
+            direct_db,
+            NULL);
+}
 
+/* Whether to read the calls straight from the event logger database.
+ * Read on every populate, so it can be switched at runtime. */
+gboolean get_direct_db()
+{
+	/* Get the default client */
+	GConfClient *client = gconf_client_get_default();
+
+	gconf_client_add_dir (client, "/apps/extcalllog",
+	                GCONF_CLIENT_PRELOAD_NONE, NULL);
+
+	return gconf_client_get_bool(client,"/apps/extcalllog/direct_db", NULL);
+}
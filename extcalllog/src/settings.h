@@ -51,6 +51,9 @@ gint get_limit();
 gboolean set_default_type(gint default_type);
 gint get_default_type();
 
+gboolean set_direct_db(gboolean direct_db);
+gboolean get_direct_db();
+
 G_END_DECLS
 
 #endif
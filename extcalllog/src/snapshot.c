@@ -0,0 +1,184 @@
+/* This file is part of Extended Call Log
+ *
+ * Copyright (C) 2010 Thom Troy
+ *
+ * WebTexter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License (GPL) as published by
+ * the Free Software Foundation
+ *
+ * WebTexter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Extended Call Log. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ ============================================================================
+ Name        : snapshot.c
+ Author      : Matrim
+ Version     : 0.1
+ Description : First screen of the call list saved for the next start
+ ============================================================================
+ */
+
+#include "snapshot.h"
+#include "settings.h"
+#include <glib/gstdio.h>
+
+#define SNAPSHOT_GROUP "snapshot"
+#define SNAPSHOT_VERSION 2
+
+static gchar *snapshot_path()
+{
+	return g_build_filename(g_get_user_cache_dir(), APP_NAME,
+			"first-screen", NULL);
+}
+
+/* Any call logged since the snapshot changes the id of the newest one,
+ * any call deleted changes the count */
+static gboolean call_stamp(AppData *appdata, gint *newest_id, gint *n_calls)
+{
+	if(appdata->db == NULL)
+	{
+		gchar *path = rtcom_log_db_default_path();
+
+		appdata->db = rtcom_log_db_open(path);
+		g_free(path);
+	}
+
+	return appdata->db != NULL &&
+		rtcom_log_db_get_call_stamp(appdata->db, newest_id, n_calls);
+}
+
+static void set_filters(GKeyFile *key_file, AppData *appdata)
+{
+	g_key_file_set_integer(key_file, SNAPSHOT_GROUP, "type",
+			appdata->current_type);
+	g_key_file_set_integer(key_file, SNAPSHOT_GROUP, "direction",
+			appdata->current_direction);
+	g_key_file_set_boolean(key_file, SNAPSHOT_GROUP, "by-date",
+			appdata->filter_by_date);
+	g_key_file_set_integer(key_file, SNAPSHOT_GROUP, "start-date",
+			appdata->start_date);
+	g_key_file_set_integer(key_file, SNAPSHOT_GROUP, "end-date",
+			appdata->end_date);
+	g_key_file_set_integer(key_file, SNAPSHOT_GROUP, "limit", get_limit());
+}
+
+static gboolean filters_match(GKeyFile *key_file, AppData *appdata)
+{
+	gboolean by_date = g_key_file_get_boolean(key_file, SNAPSHOT_GROUP,
+			"by-date", NULL);
+
+	if(g_key_file_get_integer(key_file, SNAPSHOT_GROUP, "type", NULL)
+			!= appdata->current_type)
+		return FALSE;
+	if(g_key_file_get_integer(key_file, SNAPSHOT_GROUP, "direction", NULL)
+			!= appdata->current_direction)
+		return FALSE;
+	if(by_date != appdata->filter_by_date)
+		return FALSE;
+	if(by_date &&
+	   (g_key_file_get_integer(key_file, SNAPSHOT_GROUP, "start-date", NULL)
+			!= appdata->start_date ||
+	    g_key_file_get_integer(key_file, SNAPSHOT_GROUP, "end-date", NULL)
+			!= appdata->end_date))
+		return FALSE;
+
+	return g_key_file_get_integer(key_file, SNAPSHOT_GROUP, "limit", NULL)
+		== get_limit();
+}
+
+void snapshot_save(AppData *appdata)
+{
+	GKeyFile *key_file;
+	GError *error = NULL;
+	gchar *path, *dir, *data;
+	gsize length;
+	gint newest_id, n_calls;
+
+	path = snapshot_path();
+
+	if(!call_stamp(appdata, &newest_id, &n_calls))
+	{
+		g_unlink(path);
+		g_free(path);
+		return;
+	}
+
+	key_file = g_key_file_new();
+	g_key_file_set_integer(key_file, SNAPSHOT_GROUP, "version",
+			SNAPSHOT_VERSION);
+	g_key_file_set_integer(key_file, SNAPSHOT_GROUP, "newest-id", newest_id);
+	g_key_file_set_integer(key_file, SNAPSHOT_GROUP, "n-calls", n_calls);
+	set_filters(key_file, appdata);
+
+	if(rtcom_log_model_save_snapshot(appdata->log_model, key_file,
+				SNAPSHOT_ROWS) == 0)
+	{
+		g_unlink(path);
+		g_key_file_free(key_file);
+		g_free(path);
+		return;
+	}
+
+	dir = g_path_get_dirname(path);
+	g_mkdir_with_parents(dir, 0700);
+	g_free(dir);
+
+	data = g_key_file_to_data(key_file, &length, NULL);
+	if(!g_file_set_contents(path, data, length, &error))
+	{
+		g_warning("couldn't save the snapshot: %s", error->message);
+		g_error_free(error);
+	}
+
+	g_free(data);
+	g_key_file_free(key_file);
+	g_free(path);
+}
+
+gboolean snapshot_show(AppData *appdata)
+{
+	GKeyFile *key_file;
+	gchar *path;
+	gint newest_id, n_calls;
+	gboolean shown = FALSE;
+
+	path = snapshot_path();
+	key_file = g_key_file_new();
+
+	if(!g_key_file_load_from_file(key_file, path, G_KEY_FILE_NONE, NULL))
+	{
+		g_key_file_free(key_file);
+		g_free(path);
+		return FALSE;
+	}
+
+	if(g_key_file_get_integer(key_file, SNAPSHOT_GROUP, "version", NULL)
+			!= SNAPSHOT_VERSION)
+		g_debug("snapshot is from another version");
+	else if(!filters_match(key_file, appdata))
+		g_debug("snapshot was taken with other filters");
+	else if(!call_stamp(appdata, &newest_id, &n_calls) ||
+		g_key_file_get_integer(key_file, SNAPSHOT_GROUP, "newest-id", NULL)
+			!= newest_id ||
+		g_key_file_get_integer(key_file, SNAPSHOT_GROUP, "n-calls", NULL)
+			!= n_calls)
+		g_debug("snapshot is out of date");
+	else
+		shown = rtcom_log_model_load_snapshot(appdata->log_model,
+				key_file) > 0;
+
+	/* A stale snapshot won't get any better */
+	if(!shown)
+		g_unlink(path);
+
+	g_key_file_free(key_file);
+	g_free(path);
+
+	return shown;
+}
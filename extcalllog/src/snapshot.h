@@ -0,0 +1,39 @@
+/* This file is part of Extended Call Log
+ *
+ * Copyright (C) 2010 Thom Troy
+ *
+ * WebTexter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License (GPL) as published by
+ * the Free Software Foundation
+ *
+ * WebTexter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Extended Call Log. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+#include "main.h"
+
+G_BEGIN_DECLS
+
+/* A screenful of rows, with some to spare */
+#define SNAPSHOT_ROWS 20
+
+/* Saves the first rows of the call list together with the filters they
+ * were loaded with, for snapshot_show() on the next start. */
+void snapshot_save(AppData *appdata);
+
+/* Fills the model with the saved rows if they are still current: taken
+ * with the filters now in AppData, and with no call logged since.
+ * Returns FALSE, leaving the model alone, otherwise. */
+gboolean snapshot_show(AppData *appdata);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,578 @@
+/* This file is part of Extended Call Log
+ *
+ * Copyright (C) 2010 Thom Troy
+ *
+ * WebTexter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License (GPL) as published by
+ * the Free Software Foundation
+ *
+ * WebTexter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Extended Call Log. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Times the loading path of RTComLogModel on generated call events: how
+ * long a batch takes to fill compared to the value maps it replaced, how
+ * fast the caching thread and the staging queue get the events into the
+ * model, how long finding a row by event id takes for deletions and for
+ * a burst of updates, and what a row limit costs while loading, when it
+ * is lowered and while new events keep coming in.
+ *
+ * Loads a small number of events so it can sit in "make check"; run it
+ * with "-m perf" for the full sizes. The update burst and the live
+ * inserts have the same sizes either way. The model parts need a
+ * display and are skipped without one.
+ */
+
+#include <string.h>
+#include <gtk/gtk.h>
+
+#include "rtcom-eventlogger-ui/rtcom-log-columns.h"
+#include "rtcom-eventlogger-ui/rtcom-log-event-batch.h"
+#include "rtcom-eventlogger-ui/rtcom-log-model.h"
+
+#define QUICK_EVENTS 2000
+#define PERF_EVENTS 50000
+
+/* How many rows the event-id lookup deletes, at most */
+#define LOOKUPS_MAX 1000
+
+/* The updates sent to a model of UPDATE_ROWS rows */
+#define UPDATE_ROWS 20000
+#define UPDATES 1000
+
+/* The new events added to a list limited to LIVE_LIMIT rows */
+#define LIVE_LIMIT 5000
+#define LIVE_INSERTS 10000
+
+/* Give up on a load that doesn't finish in this time */
+#define LOAD_TIMEOUT_S 120
+
+/* The columns the event logger value maps had for every event */
+#define VALUE_MAP_COLUMNS 16
+
+static gint n_events = QUICK_EVENTS;
+static gboolean have_display = FALSE;
+
+/* The newest generated event, which the live inserts move on */
+static gint newest_event_id = 0;
+
+/* The model loaded by /rtcom-log-model/load, used by the lookups */
+static RTComLogModel * loaded_model = NULL;
+
+typedef struct
+{
+    GtkTreeModel * model;
+    gint n_rows;
+    GMainLoop * loop;
+    GTimer * timer;
+} wait_t;
+
+typedef struct
+{
+    guint inserted;
+    guint changed;
+    guint bulk_inserts;
+} signal_counts_t;
+
+static void
+_remote_uid (gint event_id, gchar * buf, gsize size)
+{
+    /* A few hundred remotes calling over and over */
+    g_snprintf(buf, size, "+35387%07d", event_id % 300);
+}
+
+static void
+_append_event (RTComLogEventBatch * batch, gint event_id)
+{
+    RTComLogEvent event;
+    gchar remote_uid[32];
+
+    _remote_uid(event_id, remote_uid, sizeof(remote_uid));
+
+    memset(&event, 0, sizeof(RTComLogEvent));
+    event.event_id = event_id;
+    event.service = g_intern_static_string("RTCOM_EL_SERVICE_CALL");
+    event.event_type = g_intern_static_string(event_id % 5 == 0 ?
+            "RTCOM_EL_EVENTTYPE_CALL_MISSED" : "RTCOM_EL_EVENTTYPE_CALL");
+    event.local_uid = g_intern_static_string("ring/tel/ring");
+    event.remote_uid = rtcom_log_event_batch_strdup(batch, remote_uid);
+    event.group_uid = event.remote_uid;
+    event.timestamp = 1262304000 + event_id * 60;
+    event.end_timestamp = event.timestamp + 30;
+    event.outgoing = event_id % 5 != 0 && event_id % 2 == 0;
+    event.count = 1;
+
+    g_array_append_val(batch->events, event);
+}
+
+static gboolean
+_read_generated (RTComLogEventBatch * batch, gint before_id, gint limit,
+        gpointer data)
+{
+    gint event_id = MIN(before_id - 1, *(gint *) data);
+
+    for(; event_id > 0 && limit > 0; event_id--, limit--)
+        _append_event(batch, event_id);
+
+    return TRUE;
+}
+
+static gboolean
+_prepare_query (RTComElQuery * query, gint before_id, gpointer data)
+{
+    return rtcom_el_query_prepare(query,
+            "service", "RTCOM_EL_SERVICE_CALL", RTCOM_EL_OP_EQUAL,
+            "id", before_id, RTCOM_EL_OP_LESS,
+            NULL);
+}
+
+static void
+_free_value (gpointer data)
+{
+    GValue * value = data;
+
+    g_value_unset(value);
+    g_slice_free(GValue, value);
+}
+
+static void
+_set_string_value (GHashTable * values, const gchar * key, const gchar * s)
+{
+    GValue * value = g_slice_new0(GValue);
+
+    g_value_init(value, G_TYPE_STRING);
+    g_value_set_string(value, s);
+    g_hash_table_insert(values, (gpointer) key, value);
+}
+
+static void
+_set_int_value (GHashTable * values, const gchar * key, gint i)
+{
+    GValue * value = g_slice_new0(GValue);
+
+    g_value_init(value, G_TYPE_INT);
+    g_value_set_int(value, i);
+    g_hash_table_insert(values, (gpointer) key, value);
+}
+
+/* Builds and reads back an event the way rtcom_el_iter_get_value_map()
+ * and the staging code used to. Returns how many values were set. */
+static gint
+_value_map_event (gint event_id)
+{
+    static const gchar * const string_keys[] = {
+        "service", "event-type", "local-uid", "remote-uid",
+        "remote-name", "remote-ebook-uid", "group-uid", "free-text",
+        "icon-name", "group-title"
+    };
+    static const gchar * const int_keys[] = {
+        "id", "start-time", "end-time", "event-count", "outgoing", "flags"
+    };
+    GHashTable * values;
+    gchar remote_uid[32];
+    gint n_set = 0;
+    guint i;
+
+    _remote_uid(event_id, remote_uid, sizeof(remote_uid));
+
+    values = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+            _free_value);
+    for(i = 0; i < G_N_ELEMENTS(string_keys); i++)
+        _set_string_value(values, string_keys[i],
+                i == 3 || i == 6 ? remote_uid : NULL);
+    for(i = 0; i < G_N_ELEMENTS(int_keys); i++)
+        _set_int_value(values, int_keys[i], event_id);
+
+    g_assert_cmpuint(g_hash_table_size(values), ==, VALUE_MAP_COLUMNS);
+
+    for(i = 0; i < G_N_ELEMENTS(int_keys); i++)
+        if(g_value_get_int(g_hash_table_lookup(values, int_keys[i])))
+            n_set++;
+    for(i = 0; i < G_N_ELEMENTS(string_keys); i++)
+        if(g_value_get_string(g_hash_table_lookup(values, string_keys[i])))
+            n_set++;
+
+    g_hash_table_destroy(values);
+
+    return n_set;
+}
+
+static void
+test_event_batch (void)
+{
+    RTComLogEventBatch * batch;
+    GTimer * timer;
+    gdouble batch_s, map_s;
+    gint event_id, sum = 0;
+    guint i;
+
+    timer = g_timer_new();
+
+    batch = rtcom_log_event_batch_new(n_events);
+    for(event_id = n_events; event_id > 0; event_id--)
+        _append_event(batch, event_id);
+    for(i = 0; i < rtcom_log_event_batch_len(batch); i++)
+        sum += rtcom_log_event_batch_index(batch, i)->event_id;
+    rtcom_log_event_batch_free(batch);
+    batch_s = g_timer_elapsed(timer, NULL);
+
+    g_assert_cmpint(sum, ==, n_events * (n_events + 1) / 2);
+
+    sum = 0;
+    g_timer_start(timer);
+    for(event_id = n_events; event_id > 0; event_id--)
+        sum += _value_map_event(event_id);
+    map_s = g_timer_elapsed(timer, NULL);
+
+    g_assert_cmpint(sum, ==, n_events * 8);
+
+    g_timer_destroy(timer);
+
+    g_test_message("%d events: batch %.3f ms, value maps %.3f ms",
+            n_events, batch_s * 1000, map_s * 1000);
+    g_test_minimized_result(batch_s * 1e9 / n_events,
+            "%.0f ns per batched event", batch_s * 1e9 / n_events);
+    g_test_minimized_result(map_s * 1e9 / n_events,
+            "%.0f ns per value map event", map_s * 1e9 / n_events);
+}
+
+static void
+_row_inserted (GtkTreeModel * model, GtkTreePath * path, GtkTreeIter * iter,
+        signal_counts_t * counts)
+{
+    counts->inserted++;
+}
+
+static void
+_row_changed (GtkTreeModel * model, GtkTreePath * path, GtkTreeIter * iter,
+        signal_counts_t * counts)
+{
+    counts->changed++;
+}
+
+static void
+_bulk_insert_begin (RTComLogModel * model, signal_counts_t * counts)
+{
+    counts->bulk_inserts++;
+}
+
+static gboolean
+_check_loaded (gpointer data)
+{
+    wait_t * wait = data;
+
+    if(gtk_tree_model_iter_n_children(wait->model, NULL) < wait->n_rows &&
+       g_timer_elapsed(wait->timer, NULL) < LOAD_TIMEOUT_S)
+        return TRUE;
+
+    g_main_loop_quit(wait->loop);
+    return FALSE;
+}
+
+static RTComLogModel *
+_new_model (gint limit)
+{
+    RTComLogModel * model;
+
+    model = RTCOM_LOG_MODEL(g_object_new(RTCOM_LOG_MODEL_TYPE,
+                "create-aggregator", FALSE, NULL));
+    rtcom_log_model_set_group_by(model, RTCOM_EL_QUERY_GROUP_BY_NONE);
+    rtcom_log_model_set_lazy_loading(model, FALSE);
+    rtcom_log_model_set_limit(model, limit);
+    rtcom_log_model_set_read_func(model, _read_generated);
+
+    return model;
+}
+
+/* Populates the model with n_generated generated events and runs the
+ * main loop until it has n_rows rows. Returns how long that took. */
+static gdouble
+_load (RTComLogModel * model, gint n_generated, gint n_rows)
+{
+    wait_t wait;
+    gdouble elapsed;
+
+    wait.model = GTK_TREE_MODEL(model);
+    wait.n_rows = n_rows;
+    wait.loop = g_main_loop_new(NULL, FALSE);
+    wait.timer = g_timer_new();
+
+    newest_event_id = n_generated;
+    rtcom_log_model_populate_query_func(model, _prepare_query,
+            &newest_event_id, NULL);
+
+    g_timeout_add(10, _check_loaded, &wait);
+    g_main_loop_run(wait.loop);
+
+    elapsed = g_timer_elapsed(wait.timer, NULL);
+    g_timer_destroy(wait.timer);
+    g_main_loop_unref(wait.loop);
+
+    g_assert_cmpint(gtk_tree_model_iter_n_children(wait.model, NULL), ==,
+            n_rows);
+
+    return elapsed;
+}
+
+static void
+test_load (void)
+{
+    RTComLogModel * model;
+    signal_counts_t counts = { 0, 0, 0 };
+    guint max_depth;
+    gdouble elapsed, rows_per_second, longest_stall_ms, read_ms, wait_ms;
+
+    if(!have_display)
+    {
+        g_test_message("no display, skipping");
+        return;
+    }
+
+    model = _new_model(-1);
+
+    g_signal_connect(model, "row-inserted",
+            G_CALLBACK(_row_inserted), &counts);
+    g_signal_connect(model, "row-changed",
+            G_CALLBACK(_row_changed), &counts);
+    g_signal_connect(model, "bulk-insert-begin",
+            G_CALLBACK(_bulk_insert_begin), &counts);
+
+    elapsed = _load(model, n_events, n_events);
+
+    rtcom_log_model_get_staging_stats(model, &rows_per_second,
+            &longest_stall_ms);
+    rtcom_log_model_get_pipeline_stats(model, NULL, &max_depth, &read_ms,
+            &wait_ms);
+
+    g_test_message("%d events in %.3f s: %.0f rows/s staged, longest "
+            "stall %.1f ms", n_events, elapsed, rows_per_second,
+            longest_stall_ms);
+    g_test_message("queue: deepest %u, %.2f ms per read, %.2f ms waiting",
+            max_depth, read_ms, wait_ms);
+    g_test_message("%u rows inserted in %u bulk inserts, %u row changes",
+            counts.inserted, counts.bulk_inserts, counts.changed);
+    g_test_minimized_result(elapsed, "%.3f s to load %d events",
+            elapsed, n_events);
+    g_test_minimized_result(longest_stall_ms, "%.1f ms longest stall",
+            longest_stall_ms);
+
+    g_signal_handlers_disconnect_matched(model, G_SIGNAL_MATCH_DATA, 0, 0,
+            NULL, NULL, &counts);
+
+    loaded_model = model;
+}
+
+static void
+test_find_event (void)
+{
+    RTComEl * backend;
+    GTimer * timer;
+    gchar remote_uid[32];
+    gint n_lookups, stride, event_id, n_rows;
+    gint i;
+    gdouble elapsed;
+
+    if(!loaded_model)
+    {
+        g_test_message("nothing loaded, skipping");
+        return;
+    }
+
+    n_rows = gtk_tree_model_iter_n_children(GTK_TREE_MODEL(loaded_model),
+            NULL);
+    n_lookups = MIN(LOOKUPS_MAX, n_rows);
+    stride = n_rows / n_lookups;
+    backend = rtcom_log_model_get_eventlogger(loaded_model);
+
+    /* Deleting an ungrouped row is a lookup by id and a removal */
+    timer = g_timer_new();
+    for(i = 0; i < n_lookups; i++)
+    {
+        event_id = 1 + i * stride;
+        _remote_uid(event_id, remote_uid, sizeof(remote_uid));
+        g_signal_emit_by_name(backend, "event-deleted", event_id,
+                "ring/tel/ring", remote_uid, NULL, remote_uid,
+                "RTCOM_EL_SERVICE_CALL");
+    }
+    elapsed = g_timer_elapsed(timer, NULL);
+    g_timer_destroy(timer);
+
+    g_assert_cmpint(gtk_tree_model_iter_n_children(
+                GTK_TREE_MODEL(loaded_model), NULL), ==,
+            n_rows - n_lookups);
+
+    g_test_message("%d deletions among %d rows in %.3f ms", n_lookups,
+            n_rows, elapsed * 1000);
+    g_test_minimized_result(elapsed * 1e6 / n_lookups,
+            "%.1f us per event-deleted", elapsed * 1e6 / n_lookups);
+
+    g_object_unref(loaded_model);
+    loaded_model = NULL;
+}
+
+static void
+test_limit (void)
+{
+    RTComLogModel * model;
+    gint limit = n_events / 4;
+    GTimer * timer;
+    gdouble load_s, trim_s;
+
+    if(!have_display)
+    {
+        g_test_message("no display, skipping");
+        return;
+    }
+
+    /* The events past the limit are skipped while loading... */
+    model = _new_model(limit);
+    load_s = _load(model, n_events, limit);
+
+    /* ...and lowering it trims the rows from the end */
+    timer = g_timer_new();
+    rtcom_log_model_set_limit(model, limit / 10);
+    trim_s = g_timer_elapsed(timer, NULL);
+    g_timer_destroy(timer);
+
+    g_assert_cmpint(gtk_tree_model_iter_n_children(GTK_TREE_MODEL(model),
+                NULL), ==, limit / 10);
+
+    g_test_message("%d of %d events loaded in %.3f s, trimmed to %d in "
+            "%.3f ms", limit, n_events, load_s, limit / 10, trim_s * 1000);
+    g_test_minimized_result(load_s, "%.3f s to load %d limited events",
+            load_s, limit);
+    g_test_minimized_result(trim_s * 1e6 / (limit - limit / 10),
+            "%.1f us per trimmed row", trim_s * 1e6 / (limit - limit / 10));
+
+    g_object_unref(model);
+}
+
+static void
+_emit_event_signal (RTComEl * backend, const gchar * signal, gint event_id)
+{
+    gchar remote_uid[32];
+
+    _remote_uid(event_id, remote_uid, sizeof(remote_uid));
+    g_signal_emit_by_name(backend, signal, event_id, "ring/tel/ring",
+            remote_uid, NULL, remote_uid, "RTCOM_EL_SERVICE_CALL");
+}
+
+static void
+test_update_burst (void)
+{
+    RTComLogModel * model;
+    RTComEl * backend;
+    signal_counts_t counts = { 0, 0, 0 };
+    GTimer * timer;
+    gdouble elapsed;
+    gint i;
+
+    if(!have_display)
+    {
+        g_test_message("no display, skipping");
+        return;
+    }
+
+    model = _new_model(-1);
+    _load(model, UPDATE_ROWS, UPDATE_ROWS);
+    backend = rtcom_log_model_get_eventlogger(model);
+
+    g_signal_connect(model, "row-changed",
+            G_CALLBACK(_row_changed), &counts);
+
+    /* Each update finds its row by id, then reads the event again from
+     * the event logger, which doesn't have the generated ones. */
+    timer = g_timer_new();
+    for(i = 0; i < UPDATES; i++)
+        _emit_event_signal(backend, "event-updated",
+                1 + i * (UPDATE_ROWS / UPDATES));
+    elapsed = g_timer_elapsed(timer, NULL);
+    g_timer_destroy(timer);
+
+    g_assert_cmpint(gtk_tree_model_iter_n_children(GTK_TREE_MODEL(model),
+                NULL), ==, UPDATE_ROWS);
+
+    g_test_message("%d updates among %d rows in %.3f ms, %u row changes",
+            UPDATES, UPDATE_ROWS, elapsed * 1000, counts.changed);
+    g_test_minimized_result(elapsed * 1e6 / UPDATES,
+            "%.1f us per event-updated", elapsed * 1e6 / UPDATES);
+
+    g_object_unref(model);
+}
+
+static void
+test_live_inserts (void)
+{
+    RTComLogModel * model;
+    RTComEl * backend;
+    GtkTreeIter iter;
+    GTimer * timer;
+    gdouble elapsed;
+    gint i, top_id = 0;
+
+    if(!have_display)
+    {
+        g_test_message("no display, skipping");
+        return;
+    }
+
+    model = _new_model(LIVE_LIMIT);
+    _load(model, LIVE_LIMIT, LIVE_LIMIT);
+    backend = rtcom_log_model_get_eventlogger(model);
+
+    /* New events wait a moment to be read together; an update stages
+     * them right away, and one of an event we don't have costs nothing
+     * more. So each new event is read, prepended and trims the last row
+     * on its own, as when calls come in one by one. */
+    timer = g_timer_new();
+    for(i = 0; i < LIVE_INSERTS; i++)
+    {
+        newest_event_id++;
+        _emit_event_signal(backend, "new-event", newest_event_id);
+        _emit_event_signal(backend, "event-updated", 0);
+    }
+    elapsed = g_timer_elapsed(timer, NULL);
+    g_timer_destroy(timer);
+
+    g_assert_cmpint(gtk_tree_model_iter_n_children(GTK_TREE_MODEL(model),
+                NULL), ==, LIVE_LIMIT);
+    g_assert(gtk_tree_model_get_iter_first(GTK_TREE_MODEL(model), &iter));
+    gtk_tree_model_get(GTK_TREE_MODEL(model), &iter,
+            RTCOM_LOG_VIEW_COL_EVENT_ID, &top_id, -1);
+    g_assert_cmpint(top_id, ==, newest_event_id);
+
+    g_test_message("%d new events at a limit of %d in %.3f s",
+            LIVE_INSERTS, LIVE_LIMIT, elapsed);
+    g_test_minimized_result(elapsed * 1e6 / LIVE_INSERTS,
+            "%.1f us per new event", elapsed * 1e6 / LIVE_INSERTS);
+
+    g_object_unref(model);
+}
+
+int
+main (int argc, char * argv[])
+{
+    g_thread_init(NULL);
+    g_test_init(&argc, &argv, NULL);
+    have_display = gtk_init_check(&argc, &argv);
+
+    if(g_test_perf())
+        n_events = PERF_EVENTS;
+
+    g_test_add_func("/rtcom-log-model/event-batch", test_event_batch);
+    g_test_add_func("/rtcom-log-model/load", test_load);
+    g_test_add_func("/rtcom-log-model/find-event", test_find_event);
+    g_test_add_func("/rtcom-log-model/update-burst", test_update_burst);
+    g_test_add_func("/rtcom-log-model/limit", test_limit);
+    g_test_add_func("/rtcom-log-model/live-inserts", test_live_inserts);
+
+    return g_test_run();
+}
+
+/* vim: set ai et tw=75 ts=4 sw=4: */
@@ -0,0 +1,314 @@
+/* This file is part of Extended Call Log
+ *
+ * Copyright (C) 2010 Thom Troy
+ *
+ * WebTexter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License (GPL) as published by
+ * the Free Software Foundation
+ *
+ * WebTexter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Extended Call Log. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Reads a generated fixture database through rtcom-log-db and checks the
+ * rows against what the event logger would give for the same events.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+#include <sqlite3.h>
+
+#include "rtcom-eventlogger-ui/rtcom-log-db.h"
+
+#define GSM_UID "ring/tel/ring"
+#define SIP_UID "spirit/sip/alice"
+
+/* The parts of the event logger schema rtcom-log-db reads */
+static const gchar fixture_sql[] =
+    "CREATE TABLE Services (id INTEGER PRIMARY KEY, "
+    "  name TEXT NOT NULL UNIQUE, plugin_id INTEGER, desc TEXT);"
+    "CREATE TABLE EventTypes (id INTEGER PRIMARY KEY, "
+    "  name TEXT NOT NULL UNIQUE, plugin_id INTEGER, desc TEXT);"
+    "CREATE TABLE Events (id INTEGER PRIMARY KEY, "
+    "  service_id INTEGER NOT NULL, event_type_id INTEGER NOT NULL, "
+    "  storage_time INTEGER NOT NULL, start_time INTEGER NOT NULL, "
+    "  end_time INTEGER, is_read INTEGER DEFAULT 0, "
+    "  outgoing BOOL DEFAULT 0, flags INTEGER DEFAULT 0, "
+    "  bytes_sent INTEGER DEFAULT 0, bytes_received INTEGER DEFAULT 0, "
+    "  local_uid TEXT, local_name TEXT, remote_uid TEXT, channel TEXT, "
+    "  free_text TEXT, group_uid TEXT);"
+    "CREATE TABLE Remotes (local_uid TEXT NOT NULL, "
+    "  remote_uid TEXT NOT NULL, remote_name TEXT, abook_uid TEXT, "
+    "  UNIQUE(local_uid, remote_uid));"
+    "CREATE TABLE GroupCache (event_id INTEGER UNIQUE, "
+    "  service_id INTEGER, group_uid TEXT NOT NULL, "
+    "  total_events INTEGER DEFAULT 0, read_events INTEGER DEFAULT 0, "
+    "  flags INTEGER DEFAULT 0, PRIMARY KEY(service_id, group_uid));"
+
+    "INSERT INTO Services VALUES (1, 'RTCOM_EL_SERVICE_CALL', 1, NULL);"
+    "INSERT INTO Services VALUES (2, 'RTCOM_EL_SERVICE_SMS', 2, NULL);"
+    "INSERT INTO EventTypes VALUES (1, 'RTCOM_EL_EVENTTYPE_CALL', 1, NULL);"
+    "INSERT INTO EventTypes VALUES "
+    "  (2, 'RTCOM_EL_EVENTTYPE_CALL_MISSED', 1, NULL);"
+    "INSERT INTO EventTypes VALUES "
+    "  (3, 'RTCOM_EL_EVENTTYPE_SMS_INBOUND', 2, NULL);"
+
+    /* id, service, type, storage, start, end, is_read, outgoing, flags,
+     * sent, received, local_uid, local_name, remote_uid, channel,
+     * free_text, group_uid */
+    "INSERT INTO Events VALUES (1, 1, 1, 100, 100, 160, 1, 0, 0, 0, 0, "
+    "  '" GSM_UID "', NULL, '+353871234567', NULL, NULL, 'g1');"
+    "INSERT INTO Events VALUES (2, 1, 2, 200, 200, 200, 0, 0, 0, 0, 0, "
+    "  '" GSM_UID "', NULL, '+353871234567', NULL, NULL, 'g1');"
+    "INSERT INTO Events VALUES (3, 2, 3, 250, 250, 250, 0, 0, 0, 0, 0, "
+    "  '" GSM_UID "', NULL, '+353871234567', NULL, 'hi', 'g2');"
+    "INSERT INTO Events VALUES (4, 1, 1, 300, 300, 420, 1, 1, 4, 0, 0, "
+    "  '" SIP_UID "', NULL, 'bob@example.com', NULL, 'note', 'g3');"
+    "INSERT INTO Events VALUES (5, 1, 1, 400, 400, 430, 1, 1, 0, 0, 0, "
+    "  '" GSM_UID "', NULL, '0871234567', NULL, NULL, 'g4');"
+
+    "INSERT INTO Remotes VALUES "
+    "  ('" GSM_UID "', '+353871234567', 'Alice', '42');"
+    "INSERT INTO Remotes VALUES "
+    "  ('" SIP_UID "', 'bob@example.com', 'Bob', NULL);"
+
+    "INSERT INTO GroupCache VALUES (2, 1, 'g1', 2, 1, 0);"
+    "INSERT INTO GroupCache VALUES (3, 2, 'g2', 1, 0, 0);"
+    "INSERT INTO GroupCache VALUES (4, 1, 'g3', 1, 1, 0);"
+    "INSERT INTO GroupCache VALUES (5, 1, 'g4', 1, 1, 0);";
+
+static gchar * fixture_path;
+
+static void
+_create_fixture (void)
+{
+    sqlite3 * db;
+    gint fd;
+
+    fixture_path = g_build_filename(g_get_tmp_dir(),
+            "test-rtcom-log-db-XXXXXX", NULL);
+    fd = g_mkstemp(fixture_path);
+    g_assert(fd >= 0);
+    close(fd);
+
+    g_assert(sqlite3_open(fixture_path, &db) == SQLITE_OK);
+    g_assert(sqlite3_exec(db, fixture_sql, NULL, NULL, NULL) == SQLITE_OK);
+    sqlite3_close(db);
+}
+
+static RTComLogEventBatch *
+_read (RTComLogDb * db, const RTComLogDbFilter * filter,
+        gint before_id, gint limit)
+{
+    RTComLogEventBatch * batch = rtcom_log_event_batch_new(8);
+
+    g_assert(rtcom_log_db_read_calls(db, filter, before_id, limit, batch));
+
+    return batch;
+}
+
+static void
+_init_filter (RTComLogDbFilter * filter)
+{
+    memset(filter, 0, sizeof(RTComLogDbFilter));
+    filter->outgoing = -1;
+}
+
+static void
+test_read_all (void)
+{
+    RTComLogDb * db = rtcom_log_db_open(fixture_path);
+    RTComLogDbFilter filter;
+    RTComLogEventBatch * batch;
+    RTComLogEvent * event;
+
+    g_assert(db != NULL);
+    _init_filter(&filter);
+    batch = _read(db, &filter, G_MAXINT, 100);
+
+    /* Newest first, without the SMS */
+    g_assert_cmpuint(rtcom_log_event_batch_len(batch), ==, 4);
+    g_assert_cmpint(rtcom_log_event_batch_index(batch, 0)->event_id, ==, 5);
+    g_assert_cmpint(rtcom_log_event_batch_index(batch, 1)->event_id, ==, 4);
+    g_assert_cmpint(rtcom_log_event_batch_index(batch, 2)->event_id, ==, 2);
+    g_assert_cmpint(rtcom_log_event_batch_index(batch, 3)->event_id, ==, 1);
+
+    event = rtcom_log_event_batch_index(batch, 1);
+    g_assert_cmpstr(event->service, ==, "RTCOM_EL_SERVICE_CALL");
+    g_assert_cmpstr(event->event_type, ==, "RTCOM_EL_EVENTTYPE_CALL");
+    g_assert_cmpstr(event->local_uid, ==, SIP_UID);
+    g_assert_cmpstr(event->remote_uid, ==, "bob@example.com");
+    g_assert_cmpstr(event->remote_name, ==, "Bob");
+    g_assert(event->remote_ebook_uid == NULL);
+    g_assert_cmpstr(event->text, ==, "note");
+    g_assert_cmpstr(event->group_uid, ==, "g3");
+    g_assert_cmpstr(event->icon_name, ==, "general_sent");
+    g_assert_cmpint(event->timestamp, ==, 300);
+    g_assert_cmpint(event->end_timestamp, ==, 420);
+    g_assert_cmpint(event->flags, ==, 4);
+    g_assert_cmpint(event->count, ==, 1);
+    g_assert(event->outgoing);
+
+    /* The latest event of a group carries the group's count */
+    event = rtcom_log_event_batch_index(batch, 2);
+    g_assert_cmpstr(event->event_type, ==, "RTCOM_EL_EVENTTYPE_CALL_MISSED");
+    g_assert_cmpstr(event->remote_name, ==, "Alice");
+    g_assert_cmpstr(event->remote_ebook_uid, ==, "42");
+    g_assert_cmpstr(event->icon_name, ==, "general_missed");
+    g_assert_cmpint(event->count, ==, 2);
+    g_assert(!event->outgoing);
+
+    /* and the others have none */
+    event = rtcom_log_event_batch_index(batch, 3);
+    g_assert_cmpstr(event->icon_name, ==, "general_received");
+    g_assert_cmpint(event->count, ==, 0);
+    g_assert(event->text == NULL);
+
+    /* No Remotes row */
+    event = rtcom_log_event_batch_index(batch, 0);
+    g_assert(event->remote_name == NULL);
+    g_assert_cmpstr(event->remote_uid, ==, "0871234567");
+
+    rtcom_log_event_batch_free(batch);
+    rtcom_log_db_close(db);
+}
+
+static void
+test_paging (void)
+{
+    RTComLogDb * db = rtcom_log_db_open(fixture_path);
+    RTComLogDbFilter filter;
+    RTComLogEventBatch * batch;
+
+    g_assert(db != NULL);
+    _init_filter(&filter);
+
+    batch = _read(db, &filter, 5, 2);
+    g_assert_cmpuint(rtcom_log_event_batch_len(batch), ==, 2);
+    g_assert_cmpint(rtcom_log_event_batch_index(batch, 0)->event_id, ==, 4);
+    g_assert_cmpint(rtcom_log_event_batch_index(batch, 1)->event_id, ==, 2);
+
+    /* A second read appends */
+    g_assert(rtcom_log_db_read_calls(db, &filter, 2, 2, batch));
+    g_assert_cmpuint(rtcom_log_event_batch_len(batch), ==, 3);
+    g_assert_cmpint(rtcom_log_event_batch_index(batch, 2)->event_id, ==, 1);
+
+    rtcom_log_event_batch_free(batch);
+    rtcom_log_db_close(db);
+}
+
+static void
+test_filters (void)
+{
+    RTComLogDb * db = rtcom_log_db_open(fixture_path);
+    RTComLogDbFilter filter;
+    RTComLogEventBatch * batch;
+
+    g_assert(db != NULL);
+
+    _init_filter(&filter);
+    filter.event_type = "RTCOM_EL_EVENTTYPE_CALL_MISSED";
+    filter.outgoing = 0;
+    batch = _read(db, &filter, G_MAXINT, 100);
+    g_assert_cmpuint(rtcom_log_event_batch_len(batch), ==, 1);
+    g_assert_cmpint(rtcom_log_event_batch_index(batch, 0)->event_id, ==, 2);
+    rtcom_log_event_batch_free(batch);
+
+    _init_filter(&filter);
+    filter.event_type = "RTCOM_EL_EVENTTYPE_CALL";
+    filter.outgoing = 1;
+    batch = _read(db, &filter, G_MAXINT, 100);
+    g_assert_cmpuint(rtcom_log_event_batch_len(batch), ==, 2);
+    rtcom_log_event_batch_free(batch);
+
+    _init_filter(&filter);
+    filter.local_uid = GSM_UID;
+    batch = _read(db, &filter, G_MAXINT, 100);
+    g_assert_cmpuint(rtcom_log_event_batch_len(batch), ==, 3);
+    rtcom_log_event_batch_free(batch);
+
+    filter.not_local_uid = TRUE;
+    batch = _read(db, &filter, G_MAXINT, 100);
+    g_assert_cmpuint(rtcom_log_event_batch_len(batch), ==, 1);
+    g_assert_cmpint(rtcom_log_event_batch_index(batch, 0)->event_id, ==, 4);
+    rtcom_log_event_batch_free(batch);
+
+    /* Both ends are excluded */
+    _init_filter(&filter);
+    filter.by_date = TRUE;
+    filter.start_time = 100;
+    filter.end_time = 400;
+    batch = _read(db, &filter, G_MAXINT, 100);
+    g_assert_cmpuint(rtcom_log_event_batch_len(batch), ==, 2);
+    g_assert_cmpint(rtcom_log_event_batch_index(batch, 0)->event_id, ==, 4);
+    g_assert_cmpint(rtcom_log_event_batch_index(batch, 1)->event_id, ==, 2);
+    rtcom_log_event_batch_free(batch);
+
+    rtcom_log_db_close(db);
+}
+
+static void
+test_call_stamp (void)
+{
+    RTComLogDb * db = rtcom_log_db_open(fixture_path);
+    gint id = -1;
+    gint n_calls = -1;
+
+    g_assert(db != NULL);
+    g_assert(rtcom_log_db_get_call_stamp(db, &id, &n_calls));
+    g_assert_cmpint(id, ==, 5);
+    g_assert_cmpint(n_calls, ==, 4);
+
+    rtcom_log_db_close(db);
+}
+
+static void
+test_open_missing (void)
+{
+    gchar * path = g_strconcat(fixture_path, "-missing", NULL);
+    GLogLevelFlags fatal;
+
+    /* The failure is logged as a warning, which g_test_init() made
+     * fatal */
+    fatal = g_log_set_always_fatal(G_LOG_FATAL_MASK);
+
+    /* Opened read-only, so it isn't created either */
+    g_assert(rtcom_log_db_open(path) == NULL);
+    g_assert(!g_file_test(path, G_FILE_TEST_EXISTS));
+
+    g_log_set_always_fatal(fatal);
+    g_free(path);
+}
+
+int
+main (int argc, char * argv[])
+{
+    gint ret;
+
+    g_thread_init(NULL);
+    g_test_init(&argc, &argv, NULL);
+
+    _create_fixture();
+
+    g_test_add_func("/rtcom-log-db/read-all", test_read_all);
+    g_test_add_func("/rtcom-log-db/paging", test_paging);
+    g_test_add_func("/rtcom-log-db/filters", test_filters);
+    g_test_add_func("/rtcom-log-db/call-stamp", test_call_stamp);
+    g_test_add_func("/rtcom-log-db/open-missing", test_open_missing);
+
+    ret = g_test_run();
+
+    unlink(fixture_path);
+    g_free(fixture_path);
+
+    return ret;
+}
+
+/* vim: set ai et tw=75 ts=4 sw=4: */
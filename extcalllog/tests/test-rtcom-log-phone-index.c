@@ -0,0 +1,131 @@
+/* This file is part of Extended Call Log
+ *
+ * Copyright (C) 2010 Thom Troy
+ *
+ * WebTexter is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License (GPL) as published by
+ * the Free Software Foundation
+ *
+ * WebTexter is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Extended Call Log. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Checks how the phone index normalises numbers and decides two numbers
+ * sharing a key are the same one.
+ */
+
+#include <string.h>
+#include <glib.h>
+
+/* The normalising and the matching are static */
+#include "rtcom-eventlogger-ui/rtcom-log-phone-index.c"
+
+static void
+_assert_digits (const gchar * number, const gchar * expected)
+{
+    gchar * digits = _phone_digits(number);
+
+    g_assert_cmpstr(digits, ==, expected);
+    g_free(digits);
+}
+
+/* Whether the numbers match, checked both ways round */
+static gboolean
+_numbers_match (const gchar * a, const gchar * b)
+{
+    gchar * a_digits = _phone_digits(a);
+    gchar * b_digits = _phone_digits(b);
+    gboolean match, reverse;
+
+    g_assert(a_digits != NULL);
+    g_assert(b_digits != NULL);
+
+    match = _phone_digits_match(a_digits, b_digits);
+    reverse = _phone_digits_match(b_digits, a_digits);
+    g_assert(match == reverse);
+
+    /* The index only compares numbers with the same key */
+    if (match)
+        g_assert_cmpstr(_phone_key(a_digits), ==, _phone_key(b_digits));
+
+    g_free(a_digits);
+    g_free(b_digits);
+
+    return match;
+}
+
+static void
+test_digits (void)
+{
+    _assert_digits("+353 87 123 4567", "+353871234567");
+    _assert_digits("00353871234567", "+353871234567");
+    _assert_digits("(087) 123-4567", "871234567");
+    _assert_digits("871234567", "871234567");
+    _assert_digits("+0", "+0");
+    _assert_digits("*100#", "*100#");
+
+    /* Tones dialled after a pause aren't part of the number */
+    _assert_digits("0871234567p1234", "871234567");
+    _assert_digits("0871234567,,1", "871234567");
+
+    /* A "+" after the first digit isn't a prefix */
+    _assert_digits("0871+234567", "871234567");
+
+    _assert_digits("alice@example.com", NULL);
+    _assert_digits("sip:1234", NULL);
+    _assert_digits("0", NULL);
+    _assert_digits("00", NULL);
+    _assert_digits("", NULL);
+    _assert_digits(NULL, NULL);
+}
+
+static void
+test_match (void)
+{
+    /* Written the same way */
+    g_assert(_numbers_match("+353871234567", "00353 87 123 4567"));
+    g_assert(_numbers_match("0871234567", "87 123 4567"));
+    g_assert(!_numbers_match("0871234567", "0861234567"));
+    g_assert(!_numbers_match("+353871234567", "+44871234567"));
+
+    /* A country code in front of the national number */
+    g_assert(_numbers_match("+353871234567", "0871234567"));
+    g_assert(_numbers_match("+1 555 123 4567", "555-123-4567"));
+    g_assert(_numbers_match("+3538712345", "08712345"));
+
+    /* Other leading digits make another number */
+    g_assert(!_numbers_match("0871234567", "1234567"));
+    g_assert(!_numbers_match("+353871234567", "1234567"));
+    g_assert(!_numbers_match("+353871234567", "71234567"));
+    g_assert(!_numbers_match("871234567", "3871234567"));
+    g_assert(!_numbers_match("00353871234567", "353871234567"));
+}
+
+static void
+test_short_numbers (void)
+{
+    g_assert(_numbers_match("112", "112"));
+    g_assert(_numbers_match("*100#", "*100#"));
+    g_assert(!_numbers_match("112", "+353112"));
+    g_assert(!_numbers_match("+353123456", "0123456"));
+    g_assert(!_numbers_match("50112", "112"));
+}
+
+int
+main (int argc, char * argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/rtcom-log-phone-index/digits", test_digits);
+    g_test_add_func("/rtcom-log-phone-index/match", test_match);
+    g_test_add_func("/rtcom-log-phone-index/short-numbers",
+            test_short_numbers);
+
+    return g_test_run();
+}